@@ -2260,6 +2260,7 @@ AllPlot::recalc(AllPlotObject *objects)
 
         // fill with raw data
         for (int k=0; k<objects->U.count(); k++) objects->U[k].smooth = objects->U[k].array;
+        bool filled = false;
         foreach (RideFilePoint *dp, rideItem->ride()->dataPoints()) {
             objects->smoothWatts.append(dp->watts);
             objects->smoothNP.append(dp->np);
@@ -2288,8 +2289,10 @@ AllPlot::recalc(AllPlotObject *objects)
             objects->smoothDistance.append(context->athlete->useMetricUnits ? dp->km : dp->km * MILES_PER_KM);
             objects->smoothAltitude.append(context->athlete->useMetricUnits ? dp->alt : dp->alt * FEET_PER_METER);
             objects->smoothSlope.append(dp->slope);
-            if (dp->temp == RideFile::NA && !objects->smoothTemp.empty())
+            if (dp->temp == RideFile::NA && !objects->smoothTemp.empty()) {
                 dp->temp = objects->smoothTemp.last();
+                filled = true;
+            }
             objects->smoothTemp.append(context->athlete->useMetricUnits ? dp->temp : dp->temp * FAHRENHEIT_PER_CENTIGRADE + FAHRENHEIT_ADD_CENTIGRADE);
             objects->smoothWind.append(context->athlete->useMetricUnits ? dp->headwind : dp->headwind * MILES_PER_KM);
             objects->smoothTorque.append(dp->nm);
@@ -2323,6 +2326,9 @@ AllPlot::recalc(AllPlotObject *objects)
             objects->smoothRelSpeed.append(QwtIntervalSample( bydist ? objects->smoothDistance.last() : objects->smoothTime.last(), QwtInterval(qMin(head, speed) , qMax(head, speed) ) ));
 
         }
+
+        // gaps in temperature were filled in the ride itself
+        if (filled) rideItem->ride()->invalidateColumns();
     }
 
     QVector<double> &xaxis = bydist ? objects->smoothDistance : objects->smoothTime;
@@ -2528,7 +2528,10 @@ LTMPlot::createTODCurveData(Context *context, LTMSettings *settings, MetricDetai
     if (!SearchFilterBox::isNull(metricDetail.datafilter))
         spec.addMatches(SearchFilterBox::matches(context, metricDetail.datafilter));
 
-    foreach (RideItem *ride, context->athlete->rideCache->rides()) {
+    // only the rides in the date range
+    RideCacheRange rides = context->athlete->rideCache->ridesBetween(spec.dateRange().from, spec.dateRange().to);
+    for (RideCacheRange::const_iterator it = rides.begin(); it != rides.end(); ++it) {
+        RideItem *ride = *it;
 
         if (!spec.pass(ride)) continue;
 
@@ -2648,10 +2651,15 @@ LTMPlot::createMetricData(Context *context, LTMSettings *settings, MetricDetail
     //
     double ymean_prev=0.0;
 
-    foreach (RideItem *ride, context->athlete->rideCache->rides()) { 
+    // the rides we want, with the metric values and counts
+    // taken from the cache rather than each ride in turn
+    const RideMetric *symbolMetric = RideMetricFactory::instance().rideMetric(metricDetail.symbol);
+    QVector<int> columns;
+    columns << (symbolMetric ? symbolMetric->index() : -1) << (metricDetail.metric ? metricDetail.metric->index() : -1);
+    RideCacheSelection selection = context->athlete->rideCache->select(spec, columns);
 
-        // filter out unwanted stuff
-        if (!spec.pass(ride)) continue;
+    for (int row=0; row < selection.rides.count(); row++) {
+        RideItem *ride = selection.rides[row];
 
         // day we are on
         int currentDay = groupForDate(ride->dateTime.date(), settings->groupBy);
@@ -2661,7 +2669,7 @@ LTMPlot::createMetricData(Context *context, LTMSettings *settings, MetricDetail
         if (metricDetail.type == METRIC_META)
             value = ride->getText(metricDetail.name, "0.0").toDouble();
         else
-            value = ride->getForSymbol(metricDetail.symbol);
+            value = selection.values[0][row];
 
         // check values are bounded to stop QWT going berserk
         if (std::isnan(value) || std::isinf(value)) value = 0;
@@ -2688,7 +2696,7 @@ LTMPlot::createMetricData(Context *context, LTMSettings *settings, MetricDetail
         }
 
         if (value || wantZero) {
-            unsigned long seconds = metricDetail.metric ? ride->getCountForSymbol(metricDetail.metric->symbol()) : 1;
+            unsigned long seconds = selection.counts[1][row];
             if (currentDay > lastDay) {
                 if (lastDay && wantZero) {
                     while (lastDay<currentDay && n<=maxdays) {
@@ -2807,7 +2815,10 @@ LTMPlot::createFormulaData(Context *context, LTMSettings *settings, MetricDetail
     if (!SearchFilterBox::isNull(metricDetail.datafilter))
         spec.addMatches(SearchFilterBox::matches(context, metricDetail.datafilter));
 
-    foreach (RideItem *ride, context->athlete->rideCache->rides()) { 
+    // only the rides in the date range
+    RideCacheRange rides = context->athlete->rideCache->ridesBetween(spec.dateRange().from, spec.dateRange().to);
+    for (RideCacheRange::const_iterator it = rides.begin(); it != rides.end(); ++it) {
+        RideItem *ride = *it;
 
         // filter out unwanted stuff
         if (!spec.pass(ride)) continue;
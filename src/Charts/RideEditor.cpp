@@ -1745,6 +1745,32 @@ RideEditor::endCommand(bool undo, RideCommand *cmd)
 
             break;
         }
+        case RideCommand::SetPointValues:
+        {
+            SetPointValuesCommand *spv = (SetPointValuesCommand*)cmd;
+
+            // highlight the values updated
+            QModelIndex top = model->index(spv->row, model->columnFor(spv->series));
+            QModelIndex bottom = model->index(spv->row+spv->count-1, model->columnFor(spv->series));
+
+            if (inLUW) { // remember and do it at the end
+                itemselection << top << bottom;
+            } else {
+                table->selectionModel()->select(QItemSelection(top, bottom), QItemSelectionModel::SelectCurrent);
+                table->selectionModel()->setCurrentIndex(top, QItemSelectionModel::Select);
+            }
+            break;
+        }
+        case RideCommand::InsertPoints:
+        {
+            InsertPointsCommand *ip = (InsertPointsCommand *)cmd;
+            if (undo) { // deleted these rows...
+                data->deleteRows(ip->row, ip->count);
+            } else {
+                data->insertRows(ip->row, ip->count);
+            }
+            break;
+        }
         case RideCommand::InsertPoint:
         {
             InsertPointCommand *ip = (InsertPointCommand *)cmd;
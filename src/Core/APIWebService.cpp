@@ -33,6 +33,7 @@
 
 #include <QTemporaryFile>
 #include <QFile>
+#include <QLocale>
 
 void
 APIWebService::service(HttpRequest &request, HttpResponse &response)
@@ -191,103 +192,203 @@ APIWebService::listAthletes(HttpRequest &, HttpResponse &response)
 }
 
 
-void 
-APIWebService::writeRideLine(RideItem &item, HttpRequest *request, HttpResponse *response)
+QByteArray
+APIWebService::version(const QFileInfo &info)
 {
+    // last modified and size, doesn't need to be unique across files
+    return QString("%1-%2").arg(info.exists() ? info.lastModified().toMSecsSinceEpoch() : 0, 0, 16)
+                           .arg(info.exists() ? info.size() : 0, 0, 16).toLatin1();
+}
 
-    // honour the since parameter
-    QString sincep(request->getParameter("since"));
-    QDate since(1900,01,01);
-    if (sincep != "") since = QDate::fromString(sincep,"yyyy/MM/dd");
+QString
+APIWebService::cacheKey(HttpRequest &request)
+{
+    // path and parameters, which are sorted by name
+    QString key = request.getPath();
+    QMapIterator<QByteArray, QByteArray> it(request.getParameterMap());
+    while (it.hasNext()) {
+        it.next();
+        key += "&" + it.key() + "=" + it.value();
+    }
+    return key;
+}
 
-    // before parameter
-    QString beforep(request->getParameter("before"));
-    QDate before(3000,01,01);
-    if (beforep != "") before = QDate::fromString(beforep,"yyyy/MM/dd");
+bool
+APIWebService::cached(QString key, QByteArray etag, QByteArray &body)
+{
+    QMutexLocker locker(&responseLock);
+    APIResponse *found = responses.object(key);
+    if (found && found->etag == etag) {
+        body = found->body;
+        return true;
+    }
+    return false;
+}
+
+void
+APIWebService::cache(QString key, QByteArray etag, QByteArray body)
+{
+    QMutexLocker locker(&responseLock);
+    APIResponse *add = new APIResponse;
+    add->etag = etag;
+    add->body = body;
+    responses.insert(key, add, qMax(1, body.size()));
+}
+
+// headers are as sent, so check the usual capitalisation and lower case
+static QByteArray
+header(HttpRequest &request, QByteArray name)
+{
+    QByteArray value = request.getHeader(name);
+    if (value.isEmpty()) value = request.getHeader(name.toLower());
+    return value;
+}
+
+static const char *httpDateFormat = "ddd, dd MMM yyyy hh:mm:ss 'GMT'";
+
+bool
+APIWebService::notModified(HttpRequest &request, HttpResponse &response, QByteArray etag, QDateTime modified)
+{
+    // clients should check with us before using what they have
+    response.setHeader("ETag", etag);
+    if (modified.isValid()) response.setHeader("Last-Modified", QLocale::c().toString(modified.toUTC(), httpDateFormat).toLatin1());
+    response.setHeader("Cache-Control", "no-cache");
+    response.setHeader("Vary", "Accept-Encoding");
+
+    bool unchanged = false;
+    QByteArray match = header(request, "If-None-Match");
+    QByteArray since = header(request, "If-Modified-Since");
+
+    if (!match.isEmpty()) {
+
+        // If-None-Match takes precedence
+        foreach(QByteArray tag, match.split(',')) {
+            tag = tag.trimmed();
+            if (tag == "*" || tag == etag || tag == "W/" + etag) unchanged = true;
+        }
+
+    } else if (!since.isEmpty() && modified.isValid()) {
+
+        // HTTP dates have a resolution of 1 second
+        QDateTime when = QLocale::c().toDateTime(QString(since), httpDateFormat);
+        when.setTimeSpec(Qt::UTC);
+        if (when.isValid() && modified.toMSecsSinceEpoch() / 1000 <= when.toMSecsSinceEpoch() / 1000) unchanged = true;
+    }
+
+    if (unchanged) {
+        response.setStatus(304, "Not Modified");
+        response.write(QByteArray(), true);
+    }
+    return unchanged;
+}
+
+void
+APIWebService::writeBody(HttpRequest &request, HttpResponse &response, QByteArray body)
+{
+    // qCompress is a zlib stream (which is what http calls deflate)
+    // after a 4 byte length, small responses aren't worth the effort
+    if (body.size() > 1024 && header(request, "Accept-Encoding").contains("deflate")) {
+        QByteArray deflated = qCompress(body);
+        deflated.remove(0, 4);
+        response.setHeader("Content-Encoding", "deflate");
+        response.write(deflated, true);
+    } else {
+        response.write(body, true);
+    }
+}
 
+APIRideSnapshot::~APIRideSnapshot()
+{
+    // the intervals came from the parser via RideItem::setFrom
+    foreach(RideItem *item, rides) {
+        foreach(IntervalItem *interval, item->intervals()) delete interval;
+        delete item;
+    }
+}
+
+void 
+APIWebService::writeRideLine(RideItem &item, QDate since, QDate before, listRideSettings &settings, QByteArray &out)
+{
     // in range?
     if (item.dateTime.date() < since) return;
     if (item.dateTime.date() > before) return;
 
-    // are we doing rides or intervals?
-    listRideSettings *settings = static_cast<listRideSettings *>(response->userData());
-
-    if (settings->intervals == true) {
+    if (settings.intervals == true) {
 
         // loop through all available intervals for this ride item
         foreach(IntervalItem *interval, item.intervals()){ 
 
             // date, time, filename
-            response->bwrite(item.dateTime.date().toString("yyyy/MM/dd").toLocal8Bit());
-            response->bwrite(", ");
-            response->bwrite(item.dateTime.time().toString("hh:mm:ss").toLocal8Bit());;
-            response->bwrite(", ");
-            response->bwrite(item.fileName.toLocal8Bit());
+            out += item.dateTime.date().toString("yyyy/MM/dd").toLocal8Bit();
+            out += ", ";
+            out += item.dateTime.time().toString("hh:mm:ss").toLocal8Bit();
+            out += ", ";
+            out += item.fileName.toLocal8Bit();
 
             // now the interval name and type
-            response->bwrite(", \"");
-            response->bwrite(interval->name.toLocal8Bit());
-            response->bwrite("\", ");
-            response->bwrite(QString("%1").arg(static_cast<int>(interval->type)).toLocal8Bit());
+            out += ", \"";
+            out += interval->name.toLocal8Bit();
+            out += "\", ";
+            out += QString("%1").arg(static_cast<int>(interval->type)).toLocal8Bit();
 
             // essentially the same as below .. cut and paste (refactor?XXX)
-            if (settings->wanted.count()) {
+            if (settings.wanted.count()) {
                 // specific metrics
-                foreach(int index, settings->wanted) {
+                foreach(int index, settings.wanted) {
                     double value = interval->metrics()[index];
-                    response->bwrite(",");
-                    response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
+                    out += ",";
+                    out += QString("%1").arg(value, 'f').simplified().toLocal8Bit();
                 }
             } else {
     
                 // all metrics...
                 foreach(double value, interval->metrics()) {
-                    response->bwrite(",");
-                    response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
+                    out += ",";
+                    out += QString("%1").arg(value, 'f').simplified().toLocal8Bit();
                 }
             }
-            response->bwrite("\n");
+            out += "\n";
         }
 
     } else {
 
         // date, time, filename
-        response->bwrite(item.dateTime.date().toString("yyyy/MM/dd").toLocal8Bit());
-        response->bwrite(",");
-        response->bwrite(item.dateTime.time().toString("hh:mm:ss").toLocal8Bit());;
-        response->bwrite(",");
-        response->bwrite(item.fileName.toLocal8Bit());
+        out += item.dateTime.date().toString("yyyy/MM/dd").toLocal8Bit();
+        out += ",";
+        out += item.dateTime.time().toString("hh:mm:ss").toLocal8Bit();
+        out += ",";
+        out += item.fileName.toLocal8Bit();
 
-        if (settings->wanted.count()) {
+        if (settings.wanted.count()) {
             // specific metrics
-            foreach(int index, settings->wanted) {
+            foreach(int index, settings.wanted) {
                 double value = item.metrics()[index];
-                response->bwrite(",");
-                response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
+                out += ",";
+                out += QString("%1").arg(value, 'f').simplified().toLocal8Bit();
             }
         } else {
     
             // all metrics...
             foreach(double value, item.metrics()) {
-                response->bwrite(",");
-                response->bwrite(QString("%1").arg(value, 'f').simplified().toLocal8Bit());
+                out += ",";
+                out += QString("%1").arg(value, 'f').simplified().toLocal8Bit();
             }
         }
 
         // all the metadata asked for
-        foreach(QString name, settings->metawanted) {
+        foreach(QString name, settings.metawanted) {
             QString text = item.getText(name,"");
             text.replace("\"","'");   // don't use double quotes...
             text.replace("\n","\\n"); // newlines
             text.replace("\r","\\r"); // carriage returns
             text.replace("\t","\\t"); // tabs
 
-            response->bwrite(",\"");
-            response->bwrite(text.toLocal8Bit());
-            response->bwrite("\"");
+            out += ",\"";
+            out += text.toLocal8Bit();
+            out += "\"";
         }
 
-        response->bwrite("\n");
+        out += "\n";
     }
 }
 
@@ -352,6 +453,17 @@ APIWebService::listActivity(QString athlete, QStringList paths, HttpRequest &req
             if (format == "pwx") response.setHeader("Content-Type", "application/vnd.trainingpeaks.pwx+xml; charset=ISO-8859-1");
         }
 
+        // unchanged since they last asked, or since we last converted it?
+        QByteArray etag = "\"" + version(QFileInfo(file)) + "." + format.toLatin1() + "\"";
+        if (notModified(request, response, etag, QFileInfo(file).lastModified())) return;
+
+        QByteArray body;
+        QString key = cacheKey(request);
+        if (cached(key, etag, body)) {
+            writeBody(request, response, body);
+            return;
+        }
+
         // lets read the file in as a ridefile
         QStringList errors;
         RideFile *f = RideFileFactory::instance().openRideFile(NULL, file, errors);
@@ -396,7 +508,9 @@ APIWebService::listActivity(QString athlete, QStringList paths, HttpRequest &req
             out.close();
 
             // write back in one hit
-            response.write(contents.toLocal8Bit(), true);
+            body = contents.toLocal8Bit();
+            cache(key, etag, body);
+            writeBody(request, response, body);
             return;
 
         } else {
@@ -443,48 +557,79 @@ APIWebService::listMMP(QString athlete, QStringList paths, HttpRequest &request,
     }
 
     QString filename=paths[0];
+    QString cacheDir = home.absolutePath() + "/" + athlete + "/cache";
 
+    // honour the since parameter
+    QString sincep(request.getParameter("since"));
+    QDate since(1900,01,01);
+    if (sincep != "") since = QDate::fromString(sincep,"yyyy/MM/dd");
+
+    // before parameter
+    QString beforep(request.getParameter("before"));
+    QDate before(3000,01,01);
+    if (beforep != "") before = QDate::fromString(beforep,"yyyy/MM/dd");
+
+    // what it depends upon, for bests that's all the .cpx files in
+    // the date range, which we can check without reading them
+    QByteArray etag;
+    QDateTime modified;
     if (paths[0] == "bests") {
 
-        // header
-        response.bwrite("secs, ");
-        response.bwrite(seriesp.toLocal8Bit());
-        response.bwrite("\n");
+        quint64 fingerprint = 0;
+        int count = 0;
+        foreach(QFileInfo info, QDir(cacheDir).entryInfoList(QStringList() << "*.cpx", QDir::Files)) {
+
+            QDateTime dt;
+            if (!RideFile::parseRideFileName(info.fileName(), &dt)) continue;
+            if (dt.date() < since || dt.date() > before) continue;
+
+            fingerprint += qHash(info.fileName()) ^ quint64(info.lastModified().toMSecsSinceEpoch()) ^ quint64(info.size());
+            if (!modified.isValid() || info.lastModified() > modified) modified = info.lastModified();
+            count++;
+        }
+        etag = "\"" + QString("%1-%2").arg(count, 0, 16).arg(fingerprint, 0, 16).toLatin1() + "\"";
+
+    } else {
+        QFileInfo info(cacheDir + "/" + QFileInfo(filename).completeBaseName() + ".cpx");
+        etag = "\"" + version(info) + "\"";
+        if (info.exists()) modified = info.lastModified();
+    }
+    if (notModified(request, response, etag, modified)) return;
+
+    QByteArray out;
+    QString key = cacheKey(request);
+    if (cached(key, etag, out)) {
+        writeBody(request, response, out);
+        return;
+    }
 
-        // honour the since parameter
-        QString sincep(request.getParameter("since"));
-        QDate since(1900,01,01);
-        if (sincep != "") since = QDate::fromString(sincep,"yyyy/MM/dd");
+    // header
+    out += "secs, ";
+    out += seriesp.toLocal8Bit();
+    out += "\n";
 
-        // before parameter
-        QString beforep(request.getParameter("before"));
-        QDate before(3000,01,01);
-        if (beforep != "") before = QDate::fromString(beforep,"yyyy/MM/dd");
+    if (paths[0] == "bests") {
 
         int secs=0;
-        foreach(float value, RideFileCache::meanMaxFor(home.absolutePath() + "/" + athlete + "/cache", series, since, before)) {
-            if (secs >0) response.bwrite(QString("%1, %2\n").arg(secs).arg(value).toLocal8Bit());
+        foreach(float value, RideFileCache::meanMaxFor(cacheDir, series, since, before)) {
+            if (secs >0) out += QString("%1, %2\n").arg(secs).arg(value).toLocal8Bit();
             secs++;
         }
 
-
     } else {
-        QString CPXfilename = home.absolutePath() + "/" + athlete + "/cache/" + QFileInfo(filename).completeBaseName() + ".cpx";
-
-        // header
-        response.bwrite("secs, ");
-        response.bwrite(seriesp.toLocal8Bit());
-        response.bwrite("\n");
+        QString CPXfilename = cacheDir + "/" + QFileInfo(filename).completeBaseName() + ".cpx";
 
         if (QFileInfo(CPXfilename).exists()) {
             int secs=0;
             foreach(float value, RideFileCache::meanMaxFor(CPXfilename, series)) {
-                if (secs >0) response.bwrite(QString("%1, %2\n").arg(secs).arg(value).toLocal8Bit());
+                if (secs >0) out += QString("%1, %2\n").arg(secs).arg(value).toLocal8Bit();
                 secs++;
             }
         }
-        response.flush();
     }
+
+    cache(key, etag, out);
+    writeBody(request, response, out);
 }
 
 void
@@ -674,14 +819,20 @@ APIWebService::listMeasures(QString athlete, QStringList paths, HttpRequest &req
     QDate endDate = measuresGroup->getEndDate();
     if (before < endDate) endDate = before;
 
-    while (date <= endDate) {
+    // look up each field for all the days in one go
+    QVector<QDate> dates;
+    for (; date <= endDate; date = date.addDays(1)) dates << date;
+
+    QVector<QVector<double> > values;
+    for (int i=0; i<field_symbols.count(); i++)
+        values << measuresGroup->getFieldValues(dates, i);
+
+    for (int k=0; k<dates.count(); k++) {
         response.write("\n");
-        response.write(date.toString("yyyy/MM/dd").toLocal8Bit());
+        response.write(dates[k].toString("yyyy/MM/dd").toLocal8Bit());
 
         for (int i=0; i<field_symbols.count(); i++)
-            response.write(QString(", %1").arg(measuresGroup->getFieldValue(date, i)).toLocal8Bit());
-
-        date = date.addDays(1);
+            response.write(QString(", %1").arg(values[i][k]).toLocal8Bit());
     }
     response.write("\n");
 
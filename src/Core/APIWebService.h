@@ -23,6 +23,11 @@
 #include "RideItem.h"
 #include "RideMetadata.h"
 #include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QMutex>
+#include <QCache>
+#include <QSharedPointer>
 
 struct listRideSettings {
     bool intervals;
@@ -31,13 +36,37 @@ struct listRideSettings {
     QList<QString> metawanted; // metadata to list
 };
 
+// a read only copy of an athlete's cache/rideDB.json, it is
+// shared by the connection handler threads and only reloaded
+// when the file changes
+struct APIRideSnapshot {
+    ~APIRideSnapshot();
+
+    QDateTime modified;
+    qint64 size;
+    QByteArray version; // see APIWebService::version()
+    QList<RideItem*> rides;
+};
+
+// a response we've sent before and what it depended upon
+struct APIResponse {
+    QByteArray etag;
+    QByteArray body;
+};
+
+// Requests are serviced concurrently by the HttpConnectionHandlerPool
+// threads. The rides are listed from a snapshot of rideDB.json and
+// responses are cached in memory, they carry an ETag and Last-Modified
+// derived from the files they were built from so clients polling the
+// api get a 304 when nothing changed. Responses are deflated when
+// the client accepts it.
 class APIWebService : public HttpRequestHandler
 {
 
     public:
 
         // nothing to do in constructor
-        APIWebService(QDir home, QObject *parent=NULL) : HttpRequestHandler(parent), home(home) {}
+        APIWebService(QDir home, QObject *parent=NULL) : HttpRequestHandler(parent), home(home), responses(64*1024*1024) {}
 
         // request despatchers
         void service(HttpRequest &request, HttpResponse &response);
@@ -52,10 +81,25 @@ class APIWebService : public HttpRequestHandler
         void listMeasures(QString athlete, QStringList paths, HttpRequest &request, HttpResponse &response);
 
         // utility
-        void writeRideLine(RideItem &item, HttpRequest *request, HttpResponse *response);
+        void writeRideLine(RideItem &item, QDate since, QDate before, listRideSettings &settings, QByteArray &out);
+        QSharedPointer<APIRideSnapshot> snapshot(QString athlete);
+
+        // caching and conditional requests
+        static QByteArray version(const QFileInfo &info); // changes when the file does
+        static QString cacheKey(HttpRequest &request);
+        bool cached(QString key, QByteArray etag, QByteArray &body);
+        void cache(QString key, QByteArray etag, QByteArray body);
+        bool notModified(HttpRequest &request, HttpResponse &response, QByteArray etag, QDateTime modified);
+        void writeBody(HttpRequest &request, HttpResponse &response, QByteArray body);
 
     private:
         QDir home;
+
+        QMutex snapshotLock;
+        QMap<QString, QSharedPointer<APIRideSnapshot> > snapshots;
+
+        QMutex responseLock;
+        QCache<QString, APIResponse> responses; // cost is bytes
 };
 
 #endif
@@ -26,6 +26,8 @@
 #include "RideCache.h"
 #include "Estimator.h"
 #include "RideFileCache.h"
+#include "MeanMaxIndex.h"
+#include "FreeSearch.h"
 #include "RideMetric.h"
 #include "Settings.h"
 #include "TimeUtils.h"
@@ -176,9 +178,15 @@ Athlete::Athlete(Context *context, const QDir &homeDir)
     cloudAutoDownload = new CloudServiceAutoDownload(context);
     connect(context, SIGNAL(refreshEnd()), cloudAutoDownload, SLOT(autoDownload()));
 
+    // aggregated bests, used by the estimator so needed before the cache
+    meanMaxIndex = new MeanMaxIndex(context);
+
     // now most dependencies are in get cache
     rideCache = new RideCache(context);
 
+    // free text search of the rides in the cache
+    searchIndex = new FreeSearchIndex(context);
+
     // read athlete's charts.xml and translate etc, it needs to be
     // after RideCache creation to allow for Custom Metrics initialization
     loadCharts();
@@ -224,7 +232,9 @@ Athlete::loadCharts()
 Athlete::~Athlete()
 {
     // close the ride cache down first
+    delete searchIndex;
     delete rideCache;
+    delete meanMaxIndex;
 
     // save those preset charts
     LTMSettings reader;
@@ -292,6 +302,8 @@ Athlete::checkCPX(RideItem*ride)
             newList.append(p);
     }
     cpxCache = newList;
+
+    meanMaxIndex->invalidate(ride->dateTime.date());
 }
 
 void
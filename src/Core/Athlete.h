@@ -43,6 +43,8 @@ class Seasons;
 class RideNavigator;
 class NamedSearches;
 class RideFileCache;
+class MeanMaxIndex;
+class FreeSearchIndex;
 class RideItem;
 class IntervalItem;
 class IntervalTreeView;
@@ -96,7 +98,9 @@ class Athlete : public QObject
         Seasons *seasons;
         Routes *routes;
         QList<RideFileCache*> cpxCache;
+        MeanMaxIndex *meanMaxIndex;
         RideCache *rideCache;
+        FreeSearchIndex *searchIndex;
         Measures *measures;
 
         // cloud download
@@ -174,6 +174,12 @@ BodyMeasures::setBodyMeasures(QList<BodyMeasure>&x)
 {
     bodyMeasures_ = x;
     qSort(bodyMeasures_); // date order
+
+    // we only look for weight readings at present
+    // some readings may not include this so skip them
+    weights_.clear();
+    for (int i=0; i<bodyMeasures_.count(); i++)
+        if (bodyMeasures_[i].weightkg > 0) weights_.append(bodyMeasures_[i].when.date(), i);
 }
 
 QStringList
@@ -213,37 +219,29 @@ BodyMeasures::getFieldUnits(int field, bool useMetricUnits) const {
 
 void
 BodyMeasures::getBodyMeasure(QDate date, BodyMeasure &here) const {
-    // the optimisation below is not thread safe and should be encapsulated
-    // by a mutex, but this kind of defeats to purpose of the optimisation!
-
-    //if (withings_.count() && withings_.last().when.date() <= date) here = withings_.last();
-    //if (!withings_.count() || withings_.first().when.date() > date) here = WithingsReading();
-
-    // always set to not found before searching
-    here = BodyMeasure();
 
-    // loop
-    foreach(BodyMeasure x, bodyMeasures_) {
+    // last reading with a weight on or before the date
+    // will be empty if none found
+    int i = weights_.asOf(date);
+    here = i < 0 ? BodyMeasure() : bodyMeasures_.at(i);
+}
 
-        // we only look for weight readings at present
-        // some readings may not include this so skip them
-        if (x.weightkg <= 0) continue;
+void
+BodyMeasures::getBodyMeasures(const QVector<QDate> &dates, QVector<BodyMeasure> &here) const {
 
-        if (x.when.date() <= date) here = x;
-        if (x.when.date() > date) break;
-    }
+    QVector<int> rows = weights_.asOf(dates);
 
-    // will be empty if none found
-    return;
+    here.resize(rows.count());
+    for (int k=0; k<rows.count(); k++)
+        here[k] = rows[k] < 0 ? BodyMeasure() : bodyMeasures_.at(rows[k]);
 }
 
-double
-BodyMeasures::getFieldValue(QDate date, int field, bool useMetricUnits) const {
+// return what was asked for!
+static double
+fieldValue(const BodyMeasure &weight, int field, bool useMetricUnits)
+{
     const double units_factor = useMetricUnits ? 1.0 : LB_PER_KG;
-    BodyMeasure weight;
-    getBodyMeasure(date, weight);
 
-    // return what was asked for!
     switch(field) {
 
         default:
@@ -255,3 +253,19 @@ BodyMeasures::getFieldValue(QDate date, int field, bool useMetricUnits) const {
         case BodyMeasure::FatPercent : return weight.fatpercent;
     }
 }
+
+double
+BodyMeasures::getFieldValue(QDate date, int field, bool useMetricUnits) const {
+    int i = weights_.asOf(date);
+    return fieldValue(i < 0 ? BodyMeasure() : bodyMeasures_.at(i), field, useMetricUnits);
+}
+
+QVector<double>
+BodyMeasures::getFieldValues(const QVector<QDate> &dates, int field, bool useMetricUnits) const {
+    QVector<int> rows = weights_.asOf(dates);
+
+    QVector<double> returning(rows.count());
+    for (int k=0; k<rows.count(); k++)
+        returning[k] = fieldValue(rows[k] < 0 ? BodyMeasure() : bodyMeasures_.at(rows[k]), field, useMetricUnits);
+    return returning;
+}
@@ -68,6 +68,7 @@ public:
     QList<BodyMeasure>& bodyMeasures() { return bodyMeasures_; }
     void setBodyMeasures(QList<BodyMeasure>&x);
     void getBodyMeasure(QDate date, BodyMeasure&) const;
+    void getBodyMeasures(const QVector<QDate> &dates, QVector<BodyMeasure>&) const; // dates ascending
 
     QString getSymbol() const { return "Body"; }
     QString getName() const { return tr("Body"); }
@@ -77,11 +78,13 @@ public:
     QDate getEndDate() const;
     QString getFieldUnits(int field, bool useMetricUnits=true) const;
     double getFieldValue(QDate date, int field=BodyMeasure::WeightKg, bool useMetricUnits=true) const;
+    QVector<double> getFieldValues(const QVector<QDate> &dates, int field=BodyMeasure::WeightKg, bool useMetricUnits=true) const;
 
 private:
     QDir dir;
     bool withData;
     QList<BodyMeasure> bodyMeasures_;
+    MeasuresIndex weights_; // readings that have a weight, rebuilt by setBodyMeasures
 };
 
 
@@ -28,6 +28,8 @@
 #include "DataProcessor.h"
 #include <QDebug>
 #include <QMutex>
+#include <QSet>
+#include <string.h>
 
 #ifdef GC_WANT_PYTHON
 #include "PythonEmbed.h"
@@ -3009,6 +3011,703 @@ Result Leaf::eval(DataFilterRuntime *df, Leaf *leaf, float x, RideItem *m, RideF
     return Result(0); // false
 }
 
+//
+// COMPILED FUNCTIONS
+//
+// arithmetic and comparison, as per Leaf::eval when both sides are numbers
+static inline double
+binaryOperation(int op, double lhs, double rhs)
+{
+    switch (op) {
+    case ADD: return lhs + rhs;
+    case SUBTRACT: return lhs - rhs;
+    case DIVIDE: return rhs ? lhs / rhs : 0;
+    case MULTIPLY: return lhs * rhs;
+    case POW: return rhs ? pow(lhs, rhs) : 0;
+    case EQ: return lhs == rhs;
+    case NEQ: return lhs != rhs;
+    case LT: return lhs < rhs;
+    case LTE: return lhs <= rhs;
+    case GT: return lhs > rhs;
+    case GTE: return lhs >= rhs;
+    default: return 0;
+    }
+}
+
+// math.h functions, as numbered in DataFilterFunctions
+static inline double
+mathFunction(int fnum, double x)
+{
+    switch (fnum) {
+    case 0 : return cos(x);
+    case 1 : return tan(x);
+    case 2 : return sin(x);
+    case 3 : return acos(x);
+    case 4 : return atan(x);
+    case 5 : return asin(x);
+    case 6 : return cosh(x);
+    case 7 : return tanh(x);
+    case 8 : return sinh(x);
+    case 9 : return acosh(x);
+    case 10 : return atanh(x);
+    case 11 : return asinh(x);
+    case 12 : return exp(x);
+    case 13 : return log(x);
+    case 14 : return log10(x);
+    case 15 : return ceil(x);
+    case 16 : return floor(x);
+    case 17 : return round(x);
+    case 18 : return fabs(x);
+    case 19 : return std::isinf(x);
+    case 20 : return std::isnan(x);
+    default: return 0;
+    }
+}
+
+// the DataFilterFunctions we can compile; math.h and sum .. count
+static int
+compiledFunction(Leaf *leaf)
+{
+    for (int i=0; i<=25; i++) {
+        if (DataFilterFunctions[i].name == leaf->function) {
+            if (DataFilterFunctions[i].parameters && DataFilterFunctions[i].parameters != leaf->fparms.count()) return -1;
+            return i;
+        }
+    }
+    return -1;
+}
+
+DataFilterProgram *
+DataFilterProgram::compile(DataFilterRuntime *df, Leaf *function)
+{
+    DataFilterProgram *program = new DataFilterProgram();
+    if (!function || !program->compile(df, function, 0)) {
+        delete program;
+        return NULL;
+    }
+
+    // and in blocks, if we can
+    program->compileBatch(df, function);
+
+    return program;
+}
+
+int
+DataFilterProgram::emit(int op, int arg, double value, int delta)
+{
+    Instruction instruction;
+    instruction.op = op;
+    instruction.arg = arg;
+    instruction.value = value;
+    code << instruction;
+
+    depth += delta;
+    if (depth > maxdepth) maxdepth = depth;
+
+    return code.count()-1;
+}
+
+int
+DataFilterProgram::registerFor(Leaf *symbol, bool isread)
+{
+    QString name = *(symbol->lvalue.n);
+    int index = names.indexOf(name);
+    if (index < 0) {
+        index = names.count();
+        names << name;
+        symbols << symbol;
+        read << false;
+    }
+    if (isread) read[index] = true;
+    return index;
+}
+
+bool
+DataFilterProgram::constant(DataFilterRuntime *df, Leaf *leaf, double &value)
+{
+    switch(leaf->type) {
+
+    case Leaf::Float : value = leaf->lvalue.f; return true;
+    case Leaf::Integer : value = leaf->lvalue.i; return true;
+    case Leaf::String :
+        {
+            // only dates are numbers
+            QDate date = QDate::fromString(*(leaf->lvalue.s), "yyyy/MM/dd");
+            if (!date.isValid()) return false;
+            value = QDate(1900,01,01).daysTo(date);
+            return true;
+        }
+
+    case Leaf::Logical :
+        {
+            double lhs, rhs;
+            if (leaf->op == AND || leaf->op == OR) {
+                if (!constant(df, leaf->lvalue.l, lhs) || !constant(df, leaf->rvalue.l, rhs)) return false;
+                value = leaf->op == AND ? (lhs && rhs) : (lhs || rhs);
+                return true;
+            }
+            return constant(df, leaf->lvalue.l, value);
+        }
+
+    case Leaf::UnaryOperation :
+        {
+            double lhs;
+            if (!constant(df, leaf->lvalue.l, lhs)) return false;
+            if (leaf->op == '-') value = lhs * -1;
+            else if (leaf->op == '!') value = !lhs;
+            else value = 0;
+            return true;
+        }
+
+    case Leaf::BinaryOperation :
+    case Leaf::Operation :
+        {
+            double lhs, rhs;
+            switch (leaf->op) {
+            case ADD: case SUBTRACT: case DIVIDE: case MULTIPLY: case POW:
+            case EQ: case NEQ: case LT: case LTE: case GT: case GTE:
+                if (!constant(df, leaf->lvalue.l, lhs) || !constant(df, leaf->rvalue.l, rhs)) return false;
+                value = binaryOperation(leaf->op, lhs, rhs);
+                return true;
+            default:
+                return false;
+            }
+        }
+
+    case Leaf::Function :
+        {
+            // user functions and sum .. count are compiled, not folded
+            double x;
+            if (df->functions.contains(leaf->function)) return false;
+            int fnum = compiledFunction(leaf);
+            if (fnum < 0 || fnum > 20 || !constant(df, leaf->fparms[0], x)) return false;
+            value = mathFunction(fnum, x);
+            return true;
+        }
+
+    default:
+        return false;
+    }
+}
+
+bool
+DataFilterProgram::compile(DataFilterRuntime *df, Leaf *leaf, int calls)
+{
+    if (leaf == NULL) return false;
+
+    // constant expressions are evaluated now
+    double value;
+    if (constant(df, leaf, value)) {
+        emit(Push, 0, value, +1);
+        return true;
+    }
+
+    switch(leaf->type) {
+
+    case Leaf::Logical :
+        {
+            if (leaf->op == AND || leaf->op == OR) {
+
+                // short circuit, the result is always true or false
+                QVector<int> done, fail;
+                if (!compile(df, leaf->lvalue.l, calls)) return false;
+                int lhsfalse = emit(JumpZero, 0, 0, -1);
+
+                if (leaf->op == OR) {
+                    emit(Push, 0, 1, +1);
+                    done << emit(Jump, 0, 0, -1);
+                    code[lhsfalse].arg = code.count();
+                } else fail << lhsfalse;
+
+                if (!compile(df, leaf->rvalue.l, calls)) return false;
+                fail << emit(JumpZero, 0, 0, -1);
+                emit(Push, 0, 1, +1);
+                done << emit(Jump, 0, 0, -1);
+
+                int f = emit(Push, 0, 0, +1);
+                foreach(int jump, fail) code[jump].arg = f;
+                foreach(int jump, done) code[jump].arg = code.count();
+                return true;
+            }
+            return compile(df, leaf->lvalue.l, calls);
+        }
+
+    case Leaf::Symbol :
+        {
+            QString symbol = *(leaf->lvalue.n);
+
+            // sample series take precedence
+            if (df->dataSeriesSymbols.contains(symbol)) {
+                RideFile::SeriesType type = RideFile::seriesForSymbol(symbol);
+                if (type == RideFile::index) emit(Index, 0, 0, +1);
+                else emit(Series, type, 0, +1);
+                return true;
+            }
+            emit(Load, registerFor(leaf, true), 0, +1);
+            return true;
+        }
+
+    case Leaf::UnaryOperation :
+        {
+            if (leaf->op != '-' && leaf->op != '!') return false;
+            if (!compile(df, leaf->lvalue.l, calls)) return false;
+            emit(leaf->op == '-' ? Negate : Not);
+            return true;
+        }
+
+    case Leaf::BinaryOperation :
+    case Leaf::Operation :
+        {
+            switch (leaf->op) {
+
+            case ASSIGN:
+                if (leaf->lvalue.l->type != Leaf::Symbol) return false;
+                if (!compile(df, leaf->rvalue.l, calls)) return false;
+                emit(Store, registerFor(leaf->lvalue.l, false));
+                return true;
+
+            case ELVIS:
+                {
+                    // rhs only evaluated if lhs is zero
+                    if (!compile(df, leaf->lvalue.l, calls)) return false;
+                    int jump = emit(JumpNonZeroKeep, 0, 0, -1);
+                    if (!compile(df, leaf->rvalue.l, calls)) return false;
+                    code[jump].arg = code.count();
+                    return true;
+                }
+
+            case ADD: case SUBTRACT: case DIVIDE: case MULTIPLY: case POW:
+            case EQ: case NEQ: case LT: case LTE: case GT: case GTE:
+                if (!compile(df, leaf->lvalue.l, calls)) return false;
+                if (!compile(df, leaf->rvalue.l, calls)) return false;
+                emit(Binary, leaf->op, 0, -1);
+                return true;
+
+            default:
+                // string operations
+                return false;
+            }
+        }
+
+    case Leaf::Conditional :
+        {
+            if (leaf->op != IF_ && leaf->op != 0) return false;
+
+            if (!compile(df, leaf->cond.l, calls)) return false;
+            int otherwise = emit(JumpZero, 0, 0, -1);
+            if (!compile(df, leaf->lvalue.l, calls)) return false;
+            int done = emit(Jump, 0, 0, -1);
+            code[otherwise].arg = code.count();
+            if (leaf->rvalue.l) {
+                if (!compile(df, leaf->rvalue.l, calls)) return false;
+            } else {
+                emit(Push, 0, 0, +1);
+            }
+            code[done].arg = code.count();
+            return true;
+        }
+
+    case Leaf::Index :
+        {
+            // only indexing into the ride samples
+            if (leaf->seriesType == RideFile::none) return false;
+            if (!compile(df, leaf->fparms[0], calls)) return false;
+            emit(SeriesAt, leaf->seriesType);
+            return true;
+        }
+
+    case Leaf::Compound :
+        {
+            // value of the last statement
+            if (leaf->lvalue.b->isEmpty()) {
+                emit(Push, 0, 0, +1);
+                return true;
+            }
+            for (int i=0; i<leaf->lvalue.b->count(); i++) {
+                if (i) emit(Pop, 0, 0, -1);
+                if (!compile(df, leaf->lvalue.b->at(i), calls)) return false;
+            }
+            return true;
+        }
+
+    case Leaf::Function :
+        {
+            // user functions are inlined, but not if recursive
+            if (df->functions.contains(leaf->function)) {
+                if (calls > 16) return false;
+                return compile(df, df->functions.value(leaf->function), calls+1);
+            }
+
+            int fnum = compiledFunction(leaf);
+            if (fnum < 0) return false;
+
+            foreach(Leaf *parm, leaf->fparms)
+                if (!compile(df, parm, calls)) return false;
+
+            if (fnum <= 20) emit(Call, fnum);
+            else {
+                int n = leaf->fparms.count();
+                emit(Sum + (fnum - 21), n, 0, 1 - n);
+            }
+            return true;
+        }
+
+    default:
+        // strings, vectors, loops and scripts
+        return false;
+    }
+}
+
+bool
+DataFilterProgram::compileLanes(DataFilterRuntime *df, Leaf *expression, int &at, int &length)
+{
+    // compile as usual and move it across
+    int mark = code.count();
+    int saved = depth;
+    depth = 0;
+
+    bool ok = compile(df, expression, 0);
+    for (int pc=mark; ok && pc < code.count(); pc++) {
+        switch (code[pc].op) {
+        case Store: case Jump: case JumpZero: case JumpNonZeroKeep:
+            ok = false; // side effects or branches
+            break;
+        }
+    }
+    if (ok) {
+        at = lanes.count();
+        length = code.count() - mark;
+        lanes << code.mid(mark);
+    }
+
+    code.resize(mark);
+    depth = saved;
+    return ok;
+}
+
+static bool
+isSymbol(Leaf *leaf, QString symbol)
+{
+    return leaf->type == Leaf::Symbol && *(leaf->lvalue.n) == symbol;
+}
+
+bool
+DataFilterProgram::compileReduction(DataFilterRuntime *df, Leaf *statement, Leaf *cond)
+{
+    if ((statement->type != Leaf::Operation && statement->type != Leaf::BinaryOperation) ||
+        statement->op != ASSIGN || statement->lvalue.l->type != Leaf::Symbol) return false;
+
+    QString symbol = *(statement->lvalue.l->lvalue.n);
+    if (df->dataSeriesSymbols.contains(symbol)) return false;
+
+    Reduction reduction;
+    reduction.kind = Last;
+    reduction.target = registerFor(statement->lvalue.l, false);
+    reduction.condlength = 0;
+
+    // what kind of accumulation is it ?
+    Leaf *rhs = statement->rvalue.l;
+    Leaf *expression = rhs;
+    if ((rhs->type == Leaf::Operation || rhs->type == Leaf::BinaryOperation) && rhs->op == ADD) {
+        if (isSymbol(rhs->lvalue.l, symbol)) { reduction.kind = AddTo; expression = rhs->rvalue.l; }
+        else if (isSymbol(rhs->rvalue.l, symbol)) { reduction.kind = AddTo; expression = rhs->lvalue.l; }
+    } else if ((rhs->type == Leaf::Operation || rhs->type == Leaf::BinaryOperation) && rhs->op == SUBTRACT) {
+        if (isSymbol(rhs->lvalue.l, symbol)) { reduction.kind = SubtractFrom; expression = rhs->rvalue.l; }
+    } else if (rhs->type == Leaf::Function && (rhs->function == "max" || rhs->function == "min") &&
+               !df->functions.contains(rhs->function) && rhs->fparms.count() == 2) {
+        if (isSymbol(rhs->fparms[0], symbol)) { reduction.kind = rhs->function == "max" ? MaxOf : MinOf; expression = rhs->fparms[1]; }
+    }
+
+    if (cond && !compileLanes(df, cond, reduction.cond, reduction.condlength)) return false;
+    if (!compileLanes(df, expression, reduction.expr, reduction.exprlength)) return false;
+
+    reductions << reduction;
+    return true;
+}
+
+bool
+DataFilterProgram::compileBatch(DataFilterRuntime *df, Leaf *function)
+{
+    QList<Leaf*> statements;
+    if (function->type == Leaf::Compound) statements = *(function->lvalue.b);
+    else statements << function;
+
+    bool ok = statements.count() > 0;
+    foreach(Leaf *statement, statements) {
+
+        if (!ok) break;
+
+        if (statement->type == Leaf::Conditional) {
+
+            // if without an else, for each statement in the block
+            if ((statement->op != IF_ && statement->op != 0) || statement->rvalue.l) {
+                ok = false;
+                break;
+            }
+
+            QList<Leaf*> block;
+            if (statement->lvalue.l->type == Leaf::Compound) block = *(statement->lvalue.l->lvalue.b);
+            else block << statement->lvalue.l;
+
+            foreach(Leaf *inner, block)
+                if (ok) ok = compileReduction(df, inner, statement->cond.l);
+
+        } else ok = compileReduction(df, statement, NULL);
+    }
+
+    // each symbol accumulated once, and not used in any of the
+    // expressions, otherwise the order of evaluation matters
+    QSet<int> targets;
+    foreach(const Reduction &reduction, reductions) {
+        if (targets.contains(reduction.target)) ok = false;
+        targets.insert(reduction.target);
+    }
+    foreach(const Instruction &instruction, lanes)
+        if (instruction.op == Load && targets.contains(instruction.arg)) ok = false;
+
+    if (!ok) {
+        reductions.clear();
+        lanes.clear();
+    }
+    return ok;
+}
+
+bool
+DataFilterProgram::bind(DataFilterRuntime *df, RideItem *m, const QHash<QString,RideMetric*> *c, float x) const
+{
+    df->registers.resize(names.count());
+    df->assigned.fill(false, names.count());
+    df->vmstack.resize(maxdepth + 1);
+    if (isBatch()) df->lanes.resize((maxdepth + 3) * BatchSize);
+
+    for (int i=0; i<names.count(); i++) {
+
+        QHash<QString, Result>::const_iterator it = df->symbols.constFind(names[i]);
+        if (it != df->symbols.constEnd()) {
+
+            // user symbol, vectors are not supported
+            if (!it.value().isNumber || it.value().vector.count()) return false;
+            df->registers[i] = it.value().number;
+
+        } else if (read[i]) {
+
+            // read before it is assigned, so whatever it is for the ride
+            Result value = symbols[i]->eval(df, symbols[i], x, m, NULL, c);
+            if (!value.isNumber) return false;
+            df->registers[i] = value.number;
+
+        } else df->registers[i] = 0;
+    }
+    return true;
+}
+
+void
+DataFilterProgram::unbind(DataFilterRuntime *df) const
+{
+    for (int i=0; i<names.count(); i++)
+        if (df->assigned[i]) df->symbols.insert(names[i], Result(df->registers[i]));
+}
+
+double
+DataFilterProgram::run(DataFilterRuntime *df, RideItem *m, RideFilePoint *p, int index) const
+{
+    const Instruction *instructions = code.constData();
+    const int count = code.count();
+    double *registers = df->registers.data();
+    double *stack = df->vmstack.data();
+    int sp = -1;
+
+    for (int pc=0; pc < count; pc++) {
+
+        const Instruction &i = instructions[pc];
+        switch (i.op) {
+
+        case Push: stack[++sp] = i.value; break;
+        case Load: stack[++sp] = registers[i.arg]; break;
+        case Store: registers[i.arg] = stack[sp]; df->assigned[i.arg] = true; break;
+        case Series: stack[++sp] = p->value(static_cast<RideFile::SeriesType>(i.arg)); break;
+        case Index: stack[++sp] = index; break;
+        case SeriesAt:
+            {
+                int at = stack[sp];
+                if (at < 0 || at >= m->ride()->dataPoints().count()) stack[sp] = RideFile::NIL;
+                else stack[sp] = m->ride()->dataPoints()[at]->value(static_cast<RideFile::SeriesType>(i.arg));
+            }
+            break;
+        case Negate: stack[sp] = stack[sp] * -1; break;
+        case Not: stack[sp] = !stack[sp]; break;
+        case Binary: sp--; stack[sp] = binaryOperation(i.arg, stack[sp], stack[sp+1]); break;
+        case Call: stack[sp] = mathFunction(i.arg, stack[sp]); break;
+
+        case Sum:
+        case Mean:
+            {
+                // added in the same order as Leaf::eval
+                double sum = 0;
+                for (int j=i.arg-1; j>=0; j--) sum += stack[sp-j];
+                sp -= i.arg;
+                if (i.op == Mean) sum = i.arg ? sum / double(i.arg) : 0;
+                stack[++sp] = sum;
+            }
+            break;
+
+        case Max:
+        case Min:
+            {
+                // first parameter is deepest in the stack
+                double v = i.arg ? stack[sp - i.arg + 1] : 0;
+                for (int j=1; j<i.arg; j++) {
+                    double next = stack[sp - i.arg + 1 + j];
+                    if (i.op == Max ? next > v : next < v) v = next;
+                }
+                sp -= i.arg;
+                stack[++sp] = v;
+            }
+            break;
+
+        case Count: sp -= i.arg; stack[++sp] = i.arg; break;
+        case Pop: sp--; break;
+        case Jump: pc = i.arg - 1; break;
+        case JumpZero: if (!stack[sp--]) pc = i.arg - 1; break;
+        case JumpNonZeroKeep:
+            if (stack[sp]) pc = i.arg - 1;
+            else sp--;
+            break;
+        }
+    }
+    return sp >= 0 ? stack[sp] : 0;
+}
+
+void
+DataFilterProgram::runBatch(DataFilterRuntime *df, RideItem *m, int start, int stop) const
+{
+    double *registers = df->registers.data();
+    double *conds = df->lanes.data() + ((maxdepth + 1) * BatchSize);
+    double *values = conds + BatchSize;
+
+    for (int from=start; from <= stop; from += BatchSize) {
+
+        int n = qMin(int(BatchSize), stop - from + 1);
+
+        foreach(const Reduction &reduction, reductions) {
+
+            if (reduction.condlength) runLanes(df, m, from, n, reduction.cond, reduction.condlength, conds);
+            runLanes(df, m, from, n, reduction.expr, reduction.exprlength, values);
+
+            // accumulate in sample order, just like Leaf::eval would
+            double &target = registers[reduction.target];
+            bool any = false;
+            for (int l=0; l<n; l++) {
+
+                if (reduction.condlength && !conds[l]) continue;
+                any = true;
+
+                switch (reduction.kind) {
+                case AddTo: target = target + values[l]; break;
+                case SubtractFrom: target = target - values[l]; break;
+                case MaxOf: if (values[l] > target) target = values[l]; break;
+                case MinOf: if (values[l] < target) target = values[l]; break;
+                case Last: target = values[l]; break;
+                }
+            }
+            if (any) df->assigned[reduction.target] = true;
+        }
+    }
+}
+
+void
+DataFilterProgram::runLanes(DataFilterRuntime *df, RideItem *m, int from, int n, int at, int length, double *result) const
+{
+    const QVector<RideFilePoint*> &points = m->ride()->dataPoints();
+    const double *registers = df->registers.constData();
+    double *lanestack = df->lanes.data();
+    int sp = -1;
+
+    for (int pc=at; pc < at+length; pc++) {
+
+        const Instruction &i = lanes[pc];
+
+        // row for the top of the stack, after a push if it is one
+        switch (i.op) {
+        case Push: case Load: case Series: case Index: sp++; break;
+        }
+        double *top = lanestack + (qMax(sp, 0) * BatchSize);
+
+        switch (i.op) {
+
+        case Push: for (int l=0; l<n; l++) top[l] = i.value; break;
+        case Load: for (int l=0; l<n; l++) top[l] = registers[i.arg]; break;
+        case Series:
+            {
+                RideFile::SeriesType type = static_cast<RideFile::SeriesType>(i.arg);
+                for (int l=0; l<n; l++) top[l] = points[from+l]->value(type);
+            }
+            break;
+        case Index: for (int l=0; l<n; l++) top[l] = from + l; break;
+        case SeriesAt:
+            {
+                RideFile::SeriesType type = static_cast<RideFile::SeriesType>(i.arg);
+                for (int l=0; l<n; l++) {
+                    int index = top[l];
+                    if (index < 0 || index >= points.count()) top[l] = RideFile::NIL;
+                    else top[l] = points[index]->value(type);
+                }
+            }
+            break;
+        case Negate: for (int l=0; l<n; l++) top[l] = top[l] * -1; break;
+        case Not: for (int l=0; l<n; l++) top[l] = !top[l]; break;
+
+        case Binary:
+            {
+                // one loop per operation so they can be vectorised
+                double *lhs = top - BatchSize;
+                const double *rhs = top;
+                switch (i.arg) {
+                case ADD: for (int l=0; l<n; l++) lhs[l] = lhs[l] + rhs[l]; break;
+                case SUBTRACT: for (int l=0; l<n; l++) lhs[l] = lhs[l] - rhs[l]; break;
+                case MULTIPLY: for (int l=0; l<n; l++) lhs[l] = lhs[l] * rhs[l]; break;
+                case DIVIDE: for (int l=0; l<n; l++) lhs[l] = rhs[l] ? lhs[l] / rhs[l] : 0; break;
+                default: for (int l=0; l<n; l++) lhs[l] = binaryOperation(i.arg, lhs[l], rhs[l]); break;
+                }
+                sp--;
+            }
+            break;
+
+        case Call: for (int l=0; l<n; l++) top[l] = mathFunction(i.arg, top[l]); break;
+
+        case Sum:
+        case Mean:
+        case Max:
+        case Min:
+        case Count:
+            {
+                // the parameters are in consecutive rows, first is deepest
+                double *first = lanestack + ((sp - i.arg + 1) * BatchSize);
+                for (int l=0; l<n; l++) {
+                    double v = 0;
+                    if (i.op == Count) v = i.arg;
+                    else if (i.op == Sum || i.op == Mean) {
+                        for (int j=0; j<i.arg; j++) v += first[(j * BatchSize) + l];
+                        if (i.op == Mean) v = i.arg ? v / double(i.arg) : 0;
+                    } else if (i.arg) {
+                        v = first[l];
+                        for (int j=1; j<i.arg; j++) {
+                            double next = first[(j * BatchSize) + l];
+                            if (i.op == Max ? next > v : next < v) v = next;
+                        }
+                    }
+                    first[l] = v;
+                }
+                sp = sp - i.arg + 1;
+            }
+            break;
+
+        case Pop: sp--; break;
+        }
+    }
+    memcpy(result, lanestack + (sp * BatchSize), n * sizeof(double));
+}
+
 #ifdef GC_WANT_PYTHON
 double
 DataFilterRuntime::runPythonScript(Context *context, QString script, RideItem *m, const QHash<QString,RideMetric*> *metrics, Specification spec)
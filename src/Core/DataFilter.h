@@ -137,6 +137,10 @@ public:
 
     QHash<Leaf*, int> indexes;
 
+    // registers and stacks used when running a DataFilterProgram
+    QVector<double> registers, vmstack, lanes;
+    QVector<bool> assigned;
+
     // pd models for estimates
     QList <PDModel*>models;
 
@@ -147,6 +151,87 @@ public:
 
 };
 
+// A user metric's sample, before and after functions are evaluated for
+// every sample of every ride, walking the tree each time is expensive.
+// Where a function only uses numbers, series, symbols, arithmetic and
+// the math functions it is compiled to a simple stack machine; series
+// are resolved to a SeriesType and symbols to a register when compiled
+// and constant expressions are folded.
+//
+// Anything else (strings, vectors, while loops, most builtins) is not
+// compiled and Leaf::eval must be used, which remains the reference
+// implementation; the results must be identical.
+class DataFilterProgram {
+
+    public:
+
+        // returns NULL if the function cannot be compiled
+        static DataFilterProgram *compile(DataFilterRuntime *df, Leaf *function);
+
+        // load the registers from the runtime before iterating over the
+        // samples of a ride, returns false if a symbol is not a number
+        // for this ride, in which case use Leaf::eval instead
+        bool bind(DataFilterRuntime *df, RideItem *m, const QHash<QString,RideMetric*> *c, float x) const;
+
+        // evaluate for the sample p at index in the ride
+        double run(DataFilterRuntime *df, RideItem *m, RideFilePoint *p, int index) const;
+
+        // write any symbols that were assigned back to the runtime
+        void unbind(DataFilterRuntime *df) const;
+
+        // when every statement accumulates an expression with no side
+        // effects into a symbol (x = x + e, x = x - e, x = max(x, e),
+        // x = min(x, e) or just x = e), optionally within an if, the
+        // samples from start to stop can be evaluated in blocks, one
+        // expression at a time over all the samples in the block
+        bool isBatch() const { return reductions.count() > 0; }
+        void runBatch(DataFilterRuntime *df, RideItem *m, int start, int stop) const;
+
+    private:
+
+        DataFilterProgram() : depth(0), maxdepth(0) {}
+
+        enum { Push, Load, Store, Series, Index, SeriesAt, Negate, Not, Binary, Call,
+               Sum, Mean, Max, Min, Count, Pop, Jump, JumpZero, JumpNonZeroKeep };
+
+        struct Instruction {
+            int op;
+            int arg;
+            double value;
+        };
+
+        enum { BatchSize = 256 };
+        enum { AddTo, SubtractFrom, MaxOf, MinOf, Last };
+
+        struct Reduction {
+            int kind;
+            int target; // register
+            int cond, condlength; // in lanes, condlength 0 if none
+            int expr, exprlength;
+        };
+
+        bool compile(DataFilterRuntime *df, Leaf *leaf, int calls);
+        bool compileBatch(DataFilterRuntime *df, Leaf *function);
+        bool compileReduction(DataFilterRuntime *df, Leaf *statement, Leaf *cond);
+        bool compileLanes(DataFilterRuntime *df, Leaf *expression, int &at, int &length);
+        void runLanes(DataFilterRuntime *df, RideItem *m, int from, int n, int at, int length, double *result) const;
+        bool constant(DataFilterRuntime *df, Leaf *leaf, double &value);
+        int registerFor(Leaf *symbol, bool read);
+        int emit(int op, int arg=0, double value=0, int delta=0);
+
+        QVector<Instruction> code;
+        int depth, maxdepth;
+
+        // expressions evaluated over a block of samples
+        QVector<Instruction> lanes;
+        QVector<Reduction> reductions;
+
+        // registers, one for each symbol
+        QStringList names;
+        QVector<Leaf*> symbols;
+        QVector<bool> read;
+};
+
 class DataFilter : public QObject
 {
     Q_OBJECT
@@ -25,7 +25,7 @@
 
 FreeSearch::FreeSearch(QObject *parent, Context *context) : QObject(parent), context(context)
 {
-    // nothing to do, all the data we need is in the ridecache
+    // nothing to do, the athlete keeps the index we search
 }
 
 FreeSearch::~FreeSearch()
@@ -78,43 +78,168 @@ static QStringList searchSplit(QString string)
 
 QList<QString> FreeSearch::search(QString query)
 {
-    filenames.clear();
-
     // search split will tokenise and handle quoting and escaping
     QStringList tokens = searchSplit(query);
 
-    foreach(RideItem*item, context->athlete->rideCache->rides()) {
+    filenames = context->athlete->searchIndex->search(tokens);
 
-        QMapIterator<QString,QString> meta(item->metadata());
-        meta.toFront();
-        while (meta.hasNext()) {
-            meta.next();
+    emit results(filenames);
 
-            // does the super string contain the tokens?
-            foreach(QString token, tokens) {
+    return filenames;
+}
 
-                if (meta.value().contains(token, Qt::CaseInsensitive)) {
-                    filenames << item->fileName;
-                    goto nextItem;
-                }
-            }
-        }
+//
+// FreeSearchIndex
+//
+FreeSearchIndex::FreeSearchIndex(Context *context) : context(context), built(false)
+{
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(rideChanged(RideItem*)));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
+    connect(context, SIGNAL(intervalsUpdate(RideItem*)), this, SLOT(rideChanged(RideItem*)));
+    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(rideChanged(RideItem*)));
+}
 
-        // user intervals - even autodiscovered
-        foreach(IntervalItem *interval, item->intervals()) {
+void
+FreeSearchIndex::rideChanged(RideItem *item)
+{
+    QMutexLocker locker(&lock);
+    if (built && item) dirty.insert(item);
+}
 
-            foreach (QString token, tokens) {
+void
+FreeSearchIndex::rideDeleted(RideItem *item)
+{
+    QMutexLocker locker(&lock);
+    if (!built || !item) return;
+    dirty.remove(item);
+    unindex(item);
+}
 
-                if (interval->name.contains(token, Qt::CaseInsensitive)) {
-                    filenames << item->fileName;
-                    goto nextItem;
-                }
-            }
+// words are separated by whitespace and the nulls between fields
+static QStringList
+searchWords(const QString &text)
+{
+    QStringList returning;
+    int start = 0;
+    for (int i=0; i<=text.length(); i++) {
+        if (i == text.length() || text[i].isNull() || text[i].isSpace()) {
+            if (i > start) returning << text.mid(start, i-start);
+            start = i+1;
         }
-        nextItem:;
     }
+    return returning;
+}
 
-    emit results(filenames);
+void
+FreeSearchIndex::build()
+{
+    items.clear();
+    texts.clear();
+    free.clear();
+    entries.clear();
+    postings.clear();
+    dirty.clear();
+
+    foreach(RideItem *item, context->athlete->rideCache->rides()) index(item);
+    built = true;
+}
 
-    return filenames;
+void
+FreeSearchIndex::index(RideItem *item)
+{
+    // metadata values and user intervals - even autodiscovered
+    QString text;
+    foreach(QString value, item->metadata()) text += value.toCaseFolded() + QChar(0);
+    foreach(IntervalItem *interval, item->intervals()) text += interval->name.toCaseFolded() + QChar(0);
+
+    int entry;
+    if (free.count()) {
+        entry = free.takeLast();
+        items[entry] = item;
+        texts[entry] = text;
+    } else {
+        entry = items.count();
+        items << item;
+        texts << text;
+    }
+    entries.insert(item, entry);
+
+    foreach(QString word, searchWords(text)) postings[word].insert(entry);
+}
+
+void
+FreeSearchIndex::unindex(RideItem *item)
+{
+    QHash<RideItem*, int>::iterator it = entries.find(item);
+    if (it == entries.end()) return;
+
+    int entry = it.value();
+    entries.erase(it);
+
+    foreach(QString word, searchWords(texts[entry])) {
+        QHash<QString, QSet<int> >::iterator p = postings.find(word);
+        if (p == postings.end()) continue;
+        p.value().remove(entry);
+        if (p.value().isEmpty()) postings.erase(p);
+    }
+
+    items[entry] = NULL;
+    texts[entry] = QString();
+    free << entry;
+}
+
+void
+FreeSearchIndex::matching(QString token, QSet<RideItem*> &matched)
+{
+    token = token.toCaseFolded();
+
+    // the longest word in the token, usually the token itself
+    QString longest;
+    foreach(QString word, searchWords(token)) if (word.length() > longest.length()) longest = word;
+
+    // nothing to look up; an empty token matches any field at all
+    if (longest.isEmpty()) {
+        for (int entry=0; entry<items.count(); entry++)
+            if (items[entry] && !texts[entry].isEmpty() && (token.isEmpty() || texts[entry].contains(token)))
+                matched.insert(items[entry]);
+        return;
+    }
+
+    // a single word matches within a word, anything else must be checked
+    bool word = (longest.length() == token.length());
+    QHashIterator<QString, QSet<int> > p(postings);
+    while (p.hasNext()) {
+        p.next();
+        if (!p.key().contains(longest)) continue;
+
+        foreach(int entry, p.value())
+            if (word || texts[entry].contains(token))
+                matched.insert(items[entry]);
+    }
+}
+
+QStringList
+FreeSearchIndex::search(QStringList tokens)
+{
+    QSet<RideItem*> matched;
+
+    QMutexLocker locker(&lock);
+
+    // rides can be added without telling anyone
+    if (!built || entries.count() != context->athlete->rideCache->rides().count()) build();
+
+    // bring changed rides up to date
+    foreach(RideItem *item, dirty) {
+        unindex(item);
+        index(item);
+    }
+    dirty.clear();
+
+    foreach(QString token, tokens) matching(token, matched);
+    locker.unlock();
+
+    QStringList returning;
+    foreach(RideItem *item, context->athlete->rideCache->rides())
+        if (matched.contains(item)) returning << item->fileName;
+    return returning;
 }
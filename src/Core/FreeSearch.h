@@ -23,12 +23,61 @@
 #include <QString>
 #include <QDir>
 #include <QMutex>
+#include <QHash>
+#include <QSet>
+#include <QVector>
 
 #include "Context.h"
 #include "RideMetadata.h"
 #include "RideCache.h"
 #include "RideItem.h"
 
+// An inverted index of the words in every ride's metadata and interval
+// names, case folded, so a search doesn't need to go through the text
+// of every ride on every keystroke. A token that is a single word can
+// only match within a word, so the rides to return are those with a
+// word containing it; a quoted phrase is checked against the text of
+// the rides that have its longest word. Results are the same as
+// checking each field with QString::contains(token, Qt::CaseInsensitive).
+//
+// It is built the first time it is searched and kept up to date as rides
+// are added, deleted or changed; rides that change are reindexed when
+// the next search is made.
+class FreeSearchIndex : public QObject
+{
+    Q_OBJECT
+
+    public:
+        FreeSearchIndex(Context *context);
+
+        // files of the rides matching any of the tokens, in ride cache order
+        QStringList search(QStringList tokens);
+
+    public slots:
+        void rideChanged(RideItem *item); // added, metadata or intervals changed
+        void rideDeleted(RideItem *item);
+
+    private:
+
+        // called with lock held
+        void build();
+        void index(RideItem *item);
+        void unindex(RideItem *item);
+        void matching(QString token, QSet<RideItem*> &matched);
+
+        Context *context;
+        QMutex lock;
+        bool built;
+        QSet<RideItem*> dirty;
+
+        // each field is followed by a null so tokens can't match across fields
+        QVector<RideItem*> items;     // NULL when the entry is free
+        QVector<QString> texts;
+        QList<int> free;
+        QHash<RideItem*, int> entries;
+        QHash<QString, QSet<int> > postings; // word -> entries
+};
+
 class FreeSearch : public QObject
 {
     Q_OBJECT
@@ -180,6 +180,10 @@ HrvMeasures::setHrvMeasures(QList<HrvMeasure>&x)
 {
     hrvMeasures_ = x;
     qSort(hrvMeasures_); // date order
+
+    days_.clear();
+    for (int i=0; i<hrvMeasures_.count(); i++)
+        days_.append(hrvMeasures_[i].when.date(), i);
 }
 
 QStringList
@@ -219,27 +223,27 @@ HrvMeasures::getFieldUnits(int field, bool useMetricUnits) const {
 
 void
 HrvMeasures::getHrvMeasure(QDate date, HrvMeasure &here) const {
-    // always set to not found before searching
-    here = HrvMeasure();
-
-    // loop
-    foreach(HrvMeasure x, hrvMeasures_) {
-
-        if (x.when.date() == date) here = x;
-        if (x.when.date() > date) break;
-    }
 
+    // last reading on the day
     // will be empty if none found
-    return;
+    int i = days_.on(date);
+    here = i < 0 ? HrvMeasure() : hrvMeasures_.at(i);
 }
 
-double
-HrvMeasures::getFieldValue(QDate date, int field, bool useMetricUnits) const {
-    Q_UNUSED(useMetricUnits);
-    HrvMeasure hrv;
-    getHrvMeasure(date, hrv);
+void
+HrvMeasures::getHrvMeasures(const QVector<QDate> &dates, QVector<HrvMeasure> &here) const {
+
+    QVector<int> rows = days_.on(dates);
+
+    here.resize(rows.count());
+    for (int k=0; k<rows.count(); k++)
+        here[k] = rows[k] < 0 ? HrvMeasure() : hrvMeasures_.at(rows[k]);
+}
 
-    // return what was asked for!
+// return what was asked for!
+static double
+fieldValue(const HrvMeasure &hrv, int field)
+{
     switch(field) {
 
         default:
@@ -253,3 +257,21 @@ HrvMeasures::getFieldValue(QDate date, int field, bool useMetricUnits) const {
         case HrvMeasure::RECOVERY_POINTS : return hrv.recovery_points;
     }
 }
+
+double
+HrvMeasures::getFieldValue(QDate date, int field, bool useMetricUnits) const {
+    Q_UNUSED(useMetricUnits);
+    int i = days_.on(date);
+    return fieldValue(i < 0 ? HrvMeasure() : hrvMeasures_.at(i), field);
+}
+
+QVector<double>
+HrvMeasures::getFieldValues(const QVector<QDate> &dates, int field, bool useMetricUnits) const {
+    Q_UNUSED(useMetricUnits);
+    QVector<int> rows = days_.on(dates);
+
+    QVector<double> returning(rows.count());
+    for (int k=0; k<rows.count(); k++)
+        returning[k] = fieldValue(rows[k] < 0 ? HrvMeasure() : hrvMeasures_.at(rows[k]), field);
+    return returning;
+}
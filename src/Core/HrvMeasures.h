@@ -70,6 +70,7 @@ public:
     QList<HrvMeasure>& hrvMeasures() { return hrvMeasures_; }
     void setHrvMeasures(QList<HrvMeasure>&x);
     void getHrvMeasure(QDate date, HrvMeasure&) const;
+    void getHrvMeasures(const QVector<QDate> &dates, QVector<HrvMeasure>&) const; // dates ascending
 
     QString getSymbol() const { return "Hrv"; }
     QString getName() const { return tr("Hrv"); }
@@ -79,11 +80,13 @@ public:
     QDate getEndDate() const;
     QString getFieldUnits(int field, bool useMetricUnits=true) const;
     double getFieldValue(QDate date, int field, bool useMetricUnits=true) const;
+    QVector<double> getFieldValues(const QVector<QDate> &dates, int field, bool useMetricUnits=true) const;
 
 private:
     QDir dir;
     bool withData;
     QList<HrvMeasure> hrvMeasures_;
+    MeasuresIndex days_; // rebuilt by setHrvMeasures
 };
 
 #endif
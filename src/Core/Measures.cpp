@@ -20,6 +20,8 @@
 #include "BodyMeasures.h"
 #include "HrvMeasures.h"
 
+#include <algorithm>
+
 quint16
 Measure::getFingerprint() const
 {
@@ -50,6 +52,63 @@ Measure::getSourceDescription() const {
     }
 }
 
+int
+MeasuresIndex::after(qint64 day) const
+{
+    return std::upper_bound(days.constBegin(), days.constEnd(), day) - days.constBegin();
+}
+
+int
+MeasuresIndex::asOf(QDate date) const
+{
+    int i = after(date.toJulianDay());
+    return i ? rows[i-1] : -1;
+}
+
+int
+MeasuresIndex::on(QDate date) const
+{
+    qint64 day = date.toJulianDay();
+    int i = after(day);
+    return (i && days[i-1] == day) ? rows[i-1] : -1;
+}
+
+QVector<int>
+MeasuresIndex::asOf(const QVector<QDate> &dates) const
+{
+    QVector<int> returning(dates.count(), -1);
+
+    int i=0;
+    for (int k=0; k<dates.count(); k++) {
+        qint64 day = dates[k].toJulianDay();
+
+        // out of order, so search again
+        if (k && dates[k] < dates[k-1]) i = after(day);
+
+        while (i < days.count() && days[i] <= day) i++;
+        if (i) returning[k] = rows[i-1];
+    }
+    return returning;
+}
+
+QVector<int>
+MeasuresIndex::on(const QVector<QDate> &dates) const
+{
+    QVector<int> returning(dates.count(), -1);
+
+    int i=0;
+    for (int k=0; k<dates.count(); k++) {
+        qint64 day = dates[k].toJulianDay();
+
+        // out of order, so search again
+        if (k && dates[k] < dates[k-1]) i = after(day);
+
+        while (i < days.count() && days[i] <= day) i++;
+        if (i && days[i-1] == day) returning[k] = rows[i-1];
+    }
+    return returning;
+}
+
 Measures::Measures(QDir dir, bool withData) : dir(dir), withData(withData) {
     // load in MeasuresGroupType order!
     groups.append(new BodyMeasures(dir, withData));
@@ -115,3 +174,7 @@ Measures::getFieldValue(int group, QDate date, int field, bool useMetricUnits) c
     return groups.at(group) != NULL ? groups.at(group)->getFieldValue(date, field, useMetricUnits) : 0.0;
 }
 
+QVector<double>
+Measures::getFieldValues(int group, const QVector<QDate> &dates, int field, bool useMetricUnits) const {
+    return groups.at(group) != NULL ? groups.at(group)->getFieldValues(dates, field, useMetricUnits) : QVector<double>(dates.count(), 0.0);
+}
@@ -25,6 +25,7 @@
 #include <QDir>
 #include <QString>
 #include <QStringList>
+#include <QVector>
 
 class Measure {
     Q_DECLARE_TR_FUNCTIONS(Measure)
@@ -54,6 +55,34 @@ public:
     virtual QString getSourceDescription() const;
 };
 
+// readings are held in date order, the index holds the day for each
+// reading so we can find the one for a date with a binary search rather
+// than walking them all, and for a list of dates in a single pass
+class MeasuresIndex {
+
+public:
+    void clear() { days.clear(); rows.clear(); }
+
+    // readings must be appended in date order
+    void append(QDate date, int row) { days.append(date.toJulianDay()); rows.append(row); }
+
+    // row of the last reading on or before the date, or -1 if none
+    int asOf(QDate date) const;
+
+    // row of the last reading on the date, or -1 if none
+    int on(QDate date) const;
+
+    // same again for a list of dates, they should be in ascending
+    // order (e.g. rides) so they can be resolved in one merge pass
+    QVector<int> asOf(const QVector<QDate> &dates) const;
+    QVector<int> on(const QVector<QDate> &dates) const;
+
+private:
+    int after(qint64 day) const; // first reading after the day
+    QVector<qint64> days;
+    QVector<int> rows;
+};
+
 class MeasuresGroup {
 
 public:
@@ -68,6 +97,7 @@ public:
     virtual QDate getEndDate() const = 0;
     virtual QString getFieldUnits(int field, bool useMetricUnits=true) const = 0;
     virtual double getFieldValue(QDate date, int field=0, bool useMetricUnits=true) const = 0;
+    virtual QVector<double> getFieldValues(const QVector<QDate> &dates, int field=0, bool useMetricUnits=true) const = 0;
 };
 
 class Measures {
@@ -92,6 +122,7 @@ public:
     QDate getEndDate(int group) const;
     QString getFieldUnits(int group, int field, bool useMetricUnits=true) const;
     double getFieldValue(int group, QDate date, int field, bool useMetricUnits=true) const;
+    QVector<double> getFieldValues(int group, const QVector<QDate> &dates, int field, bool useMetricUnits=true) const;
 
 private:
     QDir dir;
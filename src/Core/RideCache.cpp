@@ -49,7 +49,7 @@
 bool rideCacheGreaterThan(const RideItem *a, const RideItem *b) { return a->dateTime > b->dateTime; }
 bool rideCacheLessThan(const RideItem *a, const RideItem *b) { return a->dateTime < b->dateTime; }
 
-RideCache::RideCache(Context *context) : context(context)
+RideCache::RideCache(Context *context) : context(context), indexed(false), generation(0), columnsGeneration(-1)
 {
     directory = context->athlete->home->activities();
     plannedDirectory = context->athlete->home->planned();
@@ -129,6 +129,7 @@ RideCache::RideCache(Context *context) : context(context)
 
     // now sort it
     qSort(rides_.begin(), rides_.end(), rideCacheLessThan);
+    invalidateIndexes();
 
     // set model once we have the basics
     model_ = new RideCacheModel(context, this);
@@ -166,6 +167,14 @@ RideCache::~RideCache()
 void
 RideCache::garbageCollect()
 {
+    // they should have left the indexes when removed
+    // but make sure we don't keep a dangling pointer
+    indexLock.lock();
+    foreach(RideItem *item, delete_) {
+        if (item) unindexRide(item);
+    }
+    indexLock.unlock();
+
     foreach(RideItem *item, delete_) {
         if (item) item->deleteLater();
     }
@@ -253,14 +262,21 @@ RideCache::addRide(QString name, bool dosignal, bool select, bool useTempActivit
 
     // now add to the list, or replace if already there
     bool added = false;
-    for (int index=0; index < rides_.count(); index++) {
-        if (rides_[index]->fileName == last->fileName) {
+    RideItem *existing = getRide(last->fileName);
+    if (existing) {
+        int index = rides_.indexOf(existing);
+        if (index >= 0) {
             rides_[index] = last;
             added = true;
-            break;
         }
     }
 
+    // keep the indexes in step
+    indexLock.lock();
+    if (existing) unindexRide(existing);
+    indexRide(last);
+    indexLock.unlock();
+
     // add and sort, model needs to know !
     if (!added) {
         model_->beginReset();
@@ -336,6 +352,9 @@ RideCache::removeCurrentRide()
     model_->startRemove(index);
     rides_.remove(index, 1);
     delete_<<todelete;
+    indexLock.lock();
+    unindexRide(todelete);
+    indexLock.unlock();
     model_->endRemove(index);
 
     // delete the file by renaming it
@@ -482,6 +501,35 @@ RideCache::cancel()
     }
 }
 
+unsigned long
+RideCacheFingerprints::fingerprint(RideItem *item)
+{
+    QDate date = item->dateTime.date();
+
+    // zones are chosen by sport, -1 for no range so add one
+    quint64 key = (quint64(item->isRun) << 62) | (quint64(item->isSwim) << 61)
+                | (quint64(context->athlete->zones(item->isRun)->whichRange(date) + 1) << 40)
+                | (quint64(context->athlete->paceZones(item->isSwim)->whichRange(date) + 1) << 20)
+                | quint64(context->athlete->hrZones(item->isRun)->whichRange(date) + 1);
+
+    QMutexLocker locker(&lock);
+    QHash<quint64, unsigned long>::const_iterator it = fingerprints.constFind(key);
+    if (it != fingerprints.constEnd()) return it.value();
+
+    unsigned long returning = item->getConfigFingerprint();
+    fingerprints.insert(key, returning);
+    return returning;
+}
+
+// used to check rides for staleness with QtConcurrent
+struct RideCacheStaleCheck
+{
+    RideCacheStaleCheck(RideCacheFingerprints *fingerprints) : fingerprints(fingerprints) {}
+    void operator()(RideItem *item) { item->checkStale(fingerprints); }
+
+    RideCacheFingerprints *fingerprints;
+};
+
 // check if we need to refresh the metrics then start the thread if needed
 void
 RideCache::refresh()
@@ -489,15 +537,14 @@ RideCache::refresh()
     // already on it !
     if (future.isRunning()) return;
 
+    // check them all, in parallel since most of the time goes
+    // on stat'ing the ride and cache files for each ride
+    RideCacheFingerprints fingerprints(context);
+    QtConcurrent::blockingMap(rides_, RideCacheStaleCheck(&fingerprints));
+
     // how many need refreshing ?
     int staleCount = 0;
-
-    foreach(RideItem *item, rides_) {
-
-        // ok set stale so we refresh
-        if (item->checkStale())
-            staleCount++;
-    }
+    foreach(RideItem *item, rides_) if (item->isStale()) staleCount++;
 
     // start if there is work to do
     // and future watcher can notify of updates
@@ -517,6 +564,16 @@ RideCache::refresh()
     }
 }
 
+// check values are bounded, just in case, and a
+// temperature of -255 means there wasn't one
+static inline double
+cleanValue(double value, bool istemp)
+{
+    if (std::isnan(value) || std::isinf(value)) return 0;
+    if (istemp && value == RideFile::NA) return 0;
+    return value;
+}
+
 QString
 RideCache::getAggregate(QString name, Specification spec, bool useMetricUnits, bool nofmt)
 {
@@ -531,62 +588,57 @@ RideCache::getAggregate(QString name, Specification spec, bool useMetricUnits, b
     double rvalue = 0;
     double rcount = 0; // using double to avoid rounding issues with int when dividing
 
-    // loop through and aggregate
-    foreach (RideItem *item, rides()) {
+    // the values and durations (for averaging) of the rides we want
+    const RideMetric *duration = RideMetricFactory::instance().rideMetric("workout_time");
+    RideCacheSelection selection = select(spec, QVector<int>() << metric->index() << (duration ? duration->index() : -1));
+    const double *values = selection.values[0].constData();
+    const double *durations = selection.values[1].constData();
+    const int n = selection.rides.count();
 
-        // skip filtered rides
-        if (!spec.pass(item)) continue;
+    // do we aggregate zero values ?
+    const bool aggZero = metric->aggregateZero();
+    const bool istemp = metric->symbol() == "average_temp";
 
-        // get this value
-        double value = item->getForSymbol(name);
-        double count = item->getForSymbol("workout_time"); // for averaging
-
-        // check values are bounded, just in case
-        if (std::isnan(value) || std::isinf(value)) value = 0;
-
-        // do we aggregate zero values ?
-        bool aggZero = metric->aggregateZero();
-
-        // set aggZero to false and value to zero if is temperature and -255
-        if (metric->symbol() == "average_temp" && value == RideFile::NA) {
-            value = 0;
-            aggZero = false;
-        }
-
-        switch (metric->type()) {
-        case RideMetric::RunningTotal:
-        case RideMetric::Total:
-            rvalue += value;
-            break;
-        default:
-        case RideMetric::Average:
-            {
-            // average should be calculated taking into account
-            // the duration of the ride, otherwise high value but
-            // short rides will skew the overall average
-            if (value || aggZero) {
-                rvalue += value*count;
-                rcount += count;
-            }
-            break;
+    // loop through and aggregate
+    switch (metric->type()) {
+    case RideMetric::RunningTotal:
+    case RideMetric::Total:
+        for (int i=0; i<n; i++) rvalue += cleanValue(values[i], istemp);
+        break;
+    default:
+    case RideMetric::Average:
+        // average should be calculated taking into account
+        // the duration of the ride, otherwise high value but
+        // short rides will skew the overall average
+        for (int i=0; i<n; i++) {
+            double value = cleanValue(values[i], istemp);
+
+            // temperature of -255 means no value, don't aggregate the zero
+            if (value || (aggZero && !(istemp && values[i] == RideFile::NA))) {
+                rvalue += value*durations[i];
+                rcount += durations[i];
             }
-        case RideMetric::Low:
-            {
+        }
+        break;
+    case RideMetric::Low:
+        for (int i=0; i<n; i++) {
+            double value = cleanValue(values[i], istemp);
             if (value < rvalue) rvalue = value;
-            break;
-            }
-        case RideMetric::Peak:
-            {
+        }
+        break;
+    case RideMetric::Peak:
+        for (int i=0; i<n; i++) {
+            double value = cleanValue(values[i], istemp);
             if (value > rvalue) rvalue = value;
-            break;
-            }
-        case RideMetric::MeanSquareRoot:
-            {
-                rvalue = sqrt((pow(rvalue, 2)*rcount + pow(value,2)*count)/(rcount + count));
-                rcount += count;
-                break;
-            }
         }
+        break;
+    case RideMetric::MeanSquareRoot:
+        for (int i=0; i<n; i++) {
+            double value = cleanValue(values[i], istemp);
+            rvalue = sqrt((pow(rvalue, 2)*rcount + pow(value,2)*durations[i])/(rcount + durations[i]));
+            rcount += durations[i];
+        }
+        break;
     }
 
     // now compute the average
@@ -629,21 +681,22 @@ RideCache::getBests(QString symbol, int n, Specification specification, bool use
     if (!metric) return results;
 
     // loop through and aggregate
-    foreach (RideItem *ride, rides_) {
+    RideCacheSelection selection = select(specification, QVector<int>() << metric->index());
+    const double *values = selection.values[0].constData();
+    for (int i=0; i<selection.rides.count(); i++) {
 
-        // skip filtered rides
-        if (!specification.pass(ride)) continue;
+        // nil values are not needed
+        if (!(values[i] < 0 || values[i] > 0)) continue;
 
         // get this value
         AthleteBest add;
-        add.nvalue = ride->getForSymbol(symbol, true);
-        add.date = ride->dateTime.date();
+        add.nvalue = values[i];
+        add.date = selection.rides[i]->dateTime.date();
 
         const_cast<RideMetric*>(metric)->setValue(add.nvalue);
         add.value = metric->toString(useMetricUnits);
 
-        // nil values are not needed
-        if (add.nvalue < 0 || add.nvalue > 0) results << add;
+        results << add;
     }
 
     // now sort
@@ -681,19 +734,228 @@ RideCache::getAllFilenames()
 RideItem *
 RideCache::getRide(QString filename)
 {
-    foreach(RideItem *item, rides())
-        if (item->fileName == filename)
-            return item;
-    return NULL;
+    QMutexLocker locker(&indexLock);
+    if (!indexed) buildIndexes();
+    return byName_.value(filename, NULL);
 }
 
 RideItem *
 RideCache::getRide(QDateTime dateTime)
 {
-    foreach(RideItem *item, rides())
-        if (item->dateTime == dateTime)
-            return item;
-    return NULL;
+    // QDateTime compares as UTC, so do we
+    QMutexLocker locker(&indexLock);
+    if (!indexed) buildIndexes();
+    return byTime_.value(dateTime.toMSecsSinceEpoch(), NULL);
+}
+
+RideCacheRange
+RideCache::ridesBetween(QDate from, QDate to)
+{
+    QMutexLocker locker(&indexLock);
+    if (!indexed) buildIndexes();
+
+    // first on or after from, and first after to
+    int start = 0, stop = byDate_.count();
+    if (from.isValid()) {
+        int lo=0, hi=byDate_.count();
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (byDate_[mid]->dateTime.date() < from) lo = mid+1;
+            else hi = mid;
+        }
+        start = lo;
+    }
+    if (to.isValid()) {
+        int lo=start, hi=byDate_.count();
+        while (lo < hi) {
+            int mid = (lo + hi) / 2;
+            if (byDate_[mid]->dateTime.date() <= to) lo = mid+1;
+            else hi = mid;
+        }
+        stop = lo;
+    }
+    return RideCacheRange(byDate_, start, stop);
+}
+
+void
+RideCache::invalidateIndexes()
+{
+    QMutexLocker locker(&indexLock);
+    indexed = false;
+    generation++;
+}
+
+void
+RideCache::invalidateMetrics()
+{
+    QMutexLocker locker(&indexLock);
+    generation++;
+}
+
+// called with indexLock held, rows are byDate_
+void
+RideCache::buildRows()
+{
+    values_.clear();
+    counts_.clear();
+    rowOf_.clear();
+    days_.resize(byDate_.count());
+    for (int row=0; row<byDate_.count(); row++) {
+        days_[row] = byDate_[row]->dateTime.date().toJulianDay();
+        rowOf_.insert(byDate_[row]->fileName, row);
+    }
+    columnsGeneration = generation;
+}
+
+RideCacheSelection
+RideCache::select(Specification spec, QVector<int> metrics)
+{
+    RideCacheSelection returning;
+
+    QMutexLocker locker(&indexLock);
+    if (!indexed) buildIndexes();
+    if (columnsGeneration != generation) buildRows();
+
+    const int rows = byDate_.count();
+    const int metricCount = RideMetricFactory::instance().metricCount();
+
+    // rows in the date range, days_ is sorted
+    DateRange dr = spec.dateRange();
+    int start = 0, stop = rows;
+    if (dr.from.isValid()) start = qLowerBound(days_.begin(), days_.end(), dr.from.toJulianDay()) - days_.begin();
+    if (dr.to.isValid()) stop = qUpperBound(days_.begin()+start, days_.end(), dr.to.toJulianDay()) - days_.begin();
+    if (stop < start) stop = start;
+
+    // and which of those pass the filters, a ride passes if
+    // it is in every one, so count how many it was found in
+    QVector<QStringList> filters = spec.filterSet().filters();
+    QVector<int> found;
+    if (filters.count()) {
+        found.fill(0, stop-start);
+        for (int f=0; f<filters.count(); f++) {
+            foreach(QString name, filters[f]) {
+                QMultiHash<QString,int>::const_iterator it = rowOf_.constFind(name);
+                for (; it != rowOf_.constEnd() && it.key() == name; ++it) {
+                    int row = it.value();
+                    if (row >= start && row < stop && found[row-start] == f) found[row-start] = f+1;
+                }
+            }
+        }
+    }
+
+    QVector<int> selected;
+    selected.reserve(stop-start);
+    for (int row=start; row<stop; row++)
+        if (!filters.count() || found[row-start] == filters.count()) selected << row;
+
+    returning.rides.resize(selected.count());
+    for (int i=0; i<selected.count(); i++) returning.rides[i] = byDate_[selected[i]];
+
+    // the columns, building any we don't have yet
+    returning.values.resize(metrics.count());
+    returning.counts.resize(metrics.count());
+    for (int m=0; m<metrics.count(); m++) {
+
+        int index = metrics[m];
+        if (index < 0 || index >= metricCount) {
+            returning.values[m].fill(0, selected.count());
+            returning.counts[m].fill(1, selected.count());
+            continue;
+        }
+
+        if (!values_.contains(index)) {
+            QVector<double> values(rows), counts(rows);
+            for (int row=0; row<rows; row++) {
+                RideItem *item = byDate_[row];
+                if (item->metrics().count() == metricCount) {
+                    values[row] = item->metrics()[index];
+                    double count = item->counts().value(index, 0);
+                    counts[row] = count ? count : 1;
+                } else {
+                    values[row] = 0;
+                    counts[row] = 1;
+                }
+            }
+            values_.insert(index, values);
+            counts_.insert(index, counts);
+        }
+
+        const double *values = values_[index].constData();
+        const double *counts = counts_[index].constData();
+        QVector<double> &v = returning.values[m];
+        QVector<double> &c = returning.counts[m];
+        v.resize(selected.count());
+        c.resize(selected.count());
+        for (int i=0; i<selected.count(); i++) {
+            v[i] = values[selected[i]];
+            c[i] = counts[selected[i]];
+        }
+    }
+    return returning;
+}
+
+// called with indexLock held
+void
+RideCache::buildIndexes()
+{
+    byName_.clear();
+    byTime_.clear();
+    byName_.reserve(rides_.count());
+    byTime_.reserve(rides_.count());
+
+    byDate_ = rides_;
+    qStableSort(byDate_.begin(), byDate_.end(), rideCacheLessThan);
+
+    // first one wins when there are duplicates, same
+    // as the serial search we used to do
+    for (int i=byDate_.count()-1; i>=0; i--) {
+        RideItem *item = byDate_[i];
+        byName_.insert(item->fileName, item);
+        byTime_.insert(item->dateTime.toMSecsSinceEpoch(), item);
+    }
+    indexed = true;
+    generation++;
+}
+
+// called with indexLock held
+void
+RideCache::indexRide(RideItem *item)
+{
+    if (!indexed) return; // will be picked up when rebuilt
+    generation++;
+
+    if (!byName_.contains(item->fileName)) byName_.insert(item->fileName, item);
+    qint64 key = item->dateTime.toMSecsSinceEpoch();
+    if (!byTime_.contains(key)) byTime_.insert(key, item);
+    byDate_.insert(qUpperBound(byDate_.begin(), byDate_.end(), item, rideCacheLessThan), item);
+}
+
+// called with indexLock held
+void
+RideCache::unindexRide(RideItem *item)
+{
+    if (!indexed) return;
+    generation++;
+
+    int index = byDate_.indexOf(item);
+    if (index < 0) return;
+    byDate_.remove(index);
+
+    qint64 key = item->dateTime.toMSecsSinceEpoch();
+    bool hidden = false;
+    if (byName_.value(item->fileName) == item) { byName_.remove(item->fileName); hidden = true; }
+    if (byTime_.value(key) == item) { byTime_.remove(key); hidden = true; }
+
+    // another ride with the same name or start time may
+    // have been hidden by this one, it is now the first
+    if (hidden) {
+        foreach(RideItem *other, byDate_) {
+            if (other->fileName == item->fileName && !byName_.contains(other->fileName))
+                byName_.insert(other->fileName, other);
+            if (other->dateTime.toMSecsSinceEpoch() == key && !byTime_.contains(key))
+                byTime_.insert(key, other);
+        }
+    }
 }
 
 
@@ -26,6 +26,8 @@
 #include "PDModel.h"
 
 #include <QVector>
+#include <QHash>
+#include <QMutex>
 #include <QThread>
 
 #include <QFuture>
@@ -43,6 +45,55 @@ class AthleteBest;
 class RideCacheModel;
 class Estimator;
 
+// a range of rides in date order, taken from the date index, use
+// it in place of walking rides() and checking the date of each one
+// it holds a (shared) copy of the index so it remains valid even if
+// rides are added or removed whilst it is being iterated
+class RideCacheRange
+{
+    public:
+        typedef QVector<RideItem*>::const_iterator const_iterator;
+
+        RideCacheRange() : from(0), to(0) {}
+        RideCacheRange(const QVector<RideItem*> &rides, int from, int to) : rides(rides), from(from), to(to) {}
+
+        const_iterator begin() const { return rides.constBegin() + from; }
+        const_iterator end() const { return rides.constBegin() + to; }
+        int count() const { return to - from; }
+        bool isEmpty() const { return to == from; }
+        RideItem *at(int i) const { return rides.at(from + i); }
+
+    private:
+        QVector<RideItem*> rides;
+        int from, to;
+};
+
+// the rides that pass a specification, in date order, along with
+// the values and counts of the metrics asked for, [metric][ride]
+class RideCacheSelection
+{
+    public:
+        QVector<RideItem*> rides;
+        QVector<QVector<double> > values, counts;
+};
+
+// the zone, cp, routes and discovery fingerprint a ride is checked
+// against when looking for stale rides depends upon the zone ranges the
+// ride falls in, not the ride, so it is worked out once for each range
+// and shared by all the rides in it; safe to use from multiple threads
+class RideCacheFingerprints
+{
+    public:
+        RideCacheFingerprints(Context *context) : context(context) {}
+
+        unsigned long fingerprint(RideItem *item);
+
+    private:
+        Context *context;
+        QMutex lock;
+        QHash<quint64, unsigned long> fingerprints; // by sport and ranges
+};
+
 class RideCache : public QObject
 {
     Q_OBJECT
@@ -59,6 +110,23 @@ class RideCache : public QObject
         int count() const { return rides_.count(); }
         RideItem *getRide(QString filename);
         RideItem *getRide(QDateTime dateTime);
+
+        // rides with a start date from..to inclusive, a null
+        // date means unbounded, the same as DateRange::pass()
+        RideCacheRange ridesBetween(QDate from, QDate to);
+
+        // a ride was renamed or its start time changed
+        void invalidateIndexes();
+
+        // select rides and metric values (by index) without visiting every
+        // ride; uses the date index and a column of values for each metric
+        // that is kept until the metrics are recomputed. values are in
+        // metric units and counts are never zero, as getCountForSymbol()
+        // an index of -1 gives a value of 0 and count of 1 for every ride
+        RideCacheSelection select(Specification spec, QVector<int> metrics);
+
+        // a ride's metrics were recomputed
+        void invalidateMetrics();
 	    QList<QDateTime> getAllDates();
         QStringList getAllFilenames();
 
@@ -139,6 +207,26 @@ class RideCache : public QObject
         QDir directory, plannedDirectory;
 
         QVector<RideItem*> rides_, reverse_, delete_;
+
+        // lookup indexes, kept up to date as rides are added and removed
+        // and rebuilt on demand when invalidated, byDate_ is sorted by
+        // start time, lock is held whilst they are used or updated
+        void buildIndexes();
+        void indexRide(RideItem *item);
+        void unindexRide(RideItem *item);
+        QMutex indexLock;
+        bool indexed;
+        QHash<QString, RideItem*> byName_;
+        QHash<qint64, RideItem*> byTime_;
+        QVector<RideItem*> byDate_;
+
+        // metric columns, in byDate_ order, built as they are asked for and
+        // discarded when generation changes; also held with indexLock
+        void buildRows();
+        int generation, columnsGeneration;
+        QVector<qint64> days_; // julian day for each row
+        QMultiHash<QString, int> rowOf_;
+        QHash<int, QVector<double> > values_, counts_;
         RideCacheModel *model_;
         bool exiting;
 	    double progress_; // percent
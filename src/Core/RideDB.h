@@ -46,8 +46,6 @@
 #define RIDEDB_VERSION "1.9"
 
 class APIWebService;
-class HttpResponse;
-class HttpRequest;
 
 // using context (we are reentrant)
 struct RideDBContext {
@@ -58,8 +56,7 @@ struct RideDBContext {
 
     // api parms
     APIWebService *api;
-    HttpRequest *request;
-    HttpResponse *response;
+    QList<RideItem*> *rides; // snapshot being loaded
 
     // the scanner
     void *scanner;
@@ -18,6 +18,7 @@
  */
 
 #include "RideDB.h"
+#include "RideDBStore.h"
 #include "RideFileCache.h"
 #include "Settings.h"
 #ifdef GC_WANT_HTTP
@@ -78,33 +79,32 @@ ride: '{' rideelement_list '}'                                  {
                                                                     // a binary search, but suspect this ok < 10000 rides
                                                                     if (jc->api != NULL) {
                                                                     #ifdef GC_WANT_HTTP
-                                                                        // we're listing rides in the api
-                                                                        jc->api->writeRideLine(jc->item, jc->request, jc->response);
+                                                                        // we're taking a copy for the api, it takes
+                                                                        // the intervals too, they are cleared below
+                                                                        RideItem *copy = new RideItem;
+                                                                        copy->setFrom(jc->item);
+                                                                        jc->rides->append(copy);
                                                                     #endif
                                                                     } else {
 
                                                                         // we're loading the cache
-                                                                        bool found = false;
-                                                                        foreach(RideItem *i, jc->cache->rides()) {
-                                                                            if (i->fileName == jc->item.fileName) {
-
-                                                                                found = true;
-
-                                                                                // progress update
-                                                                                if (jc->context->mainWindow->progress) {
-
-                                                                                    // percentage progress
-                                                                                    QString m = QString("%1%")
-                                                                                    .arg(double(jc->context->mainWindow->loading++) /
-                                                                                         double(jc->cache->rides().count()) * 100.0f, 0, 'f', 0);
-                                                                                    jc->context->mainWindow->progress->setText(m);
-                                                                                    QApplication::processEvents();
-                                                                                }
-
-                                                                                // update from our loaded value
-                                                                                i->setFrom(jc->item);
-                                                                                break;
+                                                                        RideItem *i = jc->cache->getRide(jc->item.fileName);
+                                                                        bool found = (i != NULL);
+                                                                        if (found) {
+
+                                                                            // progress update
+                                                                            if (jc->context->mainWindow->progress) {
+
+                                                                                // percentage progress
+                                                                                QString m = QString("%1%")
+                                                                                .arg(double(jc->context->mainWindow->loading++) /
+                                                                                     double(jc->cache->rides().count()) * 100.0f, 0, 'f', 0);
+                                                                                jc->context->mainWindow->progress->setText(m);
+                                                                                QApplication::processEvents();
                                                                             }
+
+                                                                            // update from our loaded value
+                                                                            i->setFrom(jc->item);
                                                                         }
                                                                         // not found !
                                                                         if (found == false)
@@ -330,6 +330,10 @@ string: STRING                                               { jc->JsonString =
 void 
 RideCache::load()
 {
+    // the binary store is much quicker to read, but
+    // is only used if it is up to date with the json
+    if (RideDBStore::load(context, this)) return;
+
     // only load if it exists !
     QFile rideDB(QString("%1/%2").arg(context->athlete->home->cache().canonicalPath()).arg("rideDB.json"));
     if (rideDB.exists() && rideDB.open(QFile::ReadOnly)) {
@@ -806,26 +810,95 @@ void RideCache::save(bool opendata, QString filename)
         stream << "\n  ]\n}";
 
         rideDB.close();
+
+        // and the binary store for a quick start next time
+        if (!opendata && filename == "") RideDBStore::save(context, this);
     }
 }
 
 #ifdef GC_WANT_HTTP
 #include "RideMetadata.h"
 
+QSharedPointer<APIRideSnapshot>
+APIWebService::snapshot(QString athlete)
+{
+    QFileInfo info(QString("%1/%2/cache/rideDB.json").arg(home.absolutePath()).arg(athlete));
+    if (!info.exists()) return QSharedPointer<APIRideSnapshot>();
+
+    // one at a time, so we only load it once
+    QMutexLocker locker(&snapshotLock);
+
+    // still current?
+    QSharedPointer<APIRideSnapshot> current = snapshots.value(athlete);
+    if (current && current->modified == info.lastModified() && current->size == info.size()) return current;
+
+    QSharedPointer<APIRideSnapshot> loaded(new APIRideSnapshot);
+    loaded->modified = info.lastModified();
+    loaded->size = info.size();
+    loaded->version = version(info);
+
+    QFile rideDB(info.absoluteFilePath());
+    if (rideDB.open(QFile::ReadOnly)) {
+
+        // ok, lets read it in
+        QTextStream stream(&rideDB);
+        stream.setCodec("UTF-8");
+
+        // Read the entire file into a QString -- we avoid using fopen since it
+        // doesn't handle foreign characters well. Instead we use QFile and parse
+        // from a QString
+        QString contents = stream.readAll();
+        rideDB.close();
+
+        // create scanner context for reentrant parsing
+        RideDBContext *jc = new RideDBContext;
+        jc->cache = NULL;
+        jc->context = NULL;
+        jc->api = this;
+        jc->rides = &loaded->rides;
+        jc->old = false;
+
+        // clean item
+        jc->item.path = home.absolutePath() + "/activities";
+        jc->item.context = NULL;
+        jc->item.isstale = jc->item.isdirty = jc->item.isedit = false;
+
+        RideDBlex_init(&scanner);
+
+        // inform the parser/lexer we have a new file
+        RideDB_setString(contents, scanner);
+
+        // setup
+        jc->errors.clear();
+
+        // parse it
+        RideDBparse(jc);
+
+        // clean up
+        RideDBlex_destroy(scanner);
+
+        // regardless of errors we're done !
+        delete jc;
+    }
+
+    // requests still using the old one keep it until they're done
+    snapshots.insert(athlete, loaded);
+    return loaded;
+}
+
 void
 APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &response)
 {
     listRideSettings settings;
 
-    // the ride db
-    QString ridedb = QString("%1/%2/cache/rideDB.json").arg(home.absolutePath()).arg(athlete);
-    QFile rideDB(ridedb);
-
     // list activities and associated metrics
     response.setHeader("Content-Type", "text; charset=ISO-8859-1");
 
+    // the rides, we only read rideDB.json when it changes
+    QSharedPointer<APIRideSnapshot> rides = snapshot(athlete);
+
     // not known..
-    if (!rideDB.exists()) {
+    if (!rides) {
         response.setStatus(404);
         response.write("malformed URL or unknown athlete.\n");
         return;
@@ -836,20 +909,6 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
     if (intervalsp.toUpper() == "TRUE") settings.intervals = true;
     else settings.intervals = false;
 
-    // set user data
-    response.setUserData(&settings);
-
-    // write headings
-    const RideMetricFactory &factory = RideMetricFactory::instance();
-    QVector<const RideMetric *> indexed(factory.metricCount());
-
-    // get metrics indexed in same order as the array
-    foreach(QString name, factory.allMetrics()) {
-
-        const RideMetric *m = factory.rideMetric(name);
-        indexed[m->index()] = m;
-    }
-
     // was the metric parameter passed?
     QString metrics(request.getParameter("metrics"));
 
@@ -858,31 +917,38 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
     QStringList wantedNames;
     if (metrics != "") wantedNames = metrics.split(",");
 
-    // write headings
-    response.bwrite("date, time, filename");
-
     // don't want metrics, so do it fast by traversing the ride directory
     if (wantedNames.count() == 1 && wantedNames[0].toUpper() == "NONE") nometrics = true;
 
-    // if intervals, add interval name
-    if (settings.intervals == true) response.bwrite(", interval name, interval type");
+    // the metadata config, if we need it
+    QString metadata = request.getParameter("metadata");
+    QFileInfo metaConfig(home.absolutePath() + "/" + athlete + "/config/metadata.xml");
+    bool wantmeta = (metadata.toUpper() != "NONE" && metadata != "");
+
+    // write headings
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    QVector<const RideMetric *> indexed(factory.metricCount());
+
+    // get metrics indexed in same order as the array
+    foreach(QString name, factory.allMetrics()) {
+
+        const RideMetric *m = factory.rideMetric(name);
+        indexed[m->index()] = m;
+    }
 
     // get metadata definitions into settings
-    QString metadata = request.getParameter("metadata");
     bool nometa = true;
-    if (metadata.toUpper() != "NONE" && metadata != "") {
+    if (wantmeta) {
 
         // first lets read in meta config
-        QDir config(home.absolutePath() + "/" + athlete + "/config");
-        QString metaConfig = config.canonicalPath()+"/metadata.xml";
-        if (QFile(metaConfig).exists()) {
+        if (metaConfig.exists()) {
 
             // params to readXML - we ignore them
             QList<KeywordDefinition> keywordDefinitions;
             QString colorfield;
             QList<DefaultDefinition> defaultDefinitions;
 
-            RideMetadata::readXML(metaConfig, keywordDefinitions, settings.metafields, colorfield, defaultDefinitions);
+            RideMetadata::readXML(metaConfig.absoluteFilePath(), keywordDefinitions, settings.metafields, colorfield, defaultDefinitions);
         }
 
         SpecialFields sp;
@@ -918,8 +984,47 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
         if(settings.metawanted.count()) nometa = false;
     }
 
-    // list 'em by reading the ride cache from disk
-    if ((nometa == false || nometrics == false) && settings.intervals == false) {
+    // honour the since parameter
+    QString sincep(request.getParameter("since"));
+    QDate since(1900,01,01);
+    if (sincep != "") since = QDate::fromString(sincep,"yyyy/MM/dd");
+
+    // before parameter
+    QString beforep(request.getParameter("before"));
+    QDate before(3000,01,01);
+    if (beforep != "") before = QDate::fromString(beforep,"yyyy/MM/dd");
+
+    // what it depends upon; the directory listing when its
+    // fast or the ride cache and metadata config otherwise
+    QByteArray etag;
+    QDateTime modified;
+    bool listing = !((nometa == false || nometrics == false) && settings.intervals == false);
+    if (!listing) {
+        etag = "\"" + rides->version + "." + version(metaConfig) + "\"";
+        modified = qMax(rides->modified, metaConfig.lastModified());
+    } else {
+        QFileInfo activities(home.absolutePath() + "/" + athlete + "/activities");
+        etag = "\"" + version(activities) + "\"";
+        modified = activities.lastModified();
+    }
+    if (notModified(request, response, etag, modified)) return;
+
+    // we may have answered this before
+    QByteArray out;
+    QString key = cacheKey(request);
+    if (cached(key, etag, out)) {
+        writeBody(request, response, out);
+        return;
+    }
+
+    // write headings
+    out += "date, time, filename";
+
+    // if intervals, add interval name
+    if (settings.intervals == true) out += ", interval name, interval type";
+
+    // list 'em from the ride cache
+    if (!listing) {
 
         int i=0;
         foreach(const RideMetric *m, indexed) {
@@ -931,10 +1036,10 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
             if (wantedNames.count() && !wantedNames.contains(underscored)) continue;
 
             if (m->name().startsWith("BikeScore"))
-                response.bwrite(", BikeScore");
+                out += ", BikeScore";
             else {
-                response.bwrite(", ");
-                response.bwrite(underscored.toLocal8Bit());
+                out += ", ";
+                out += underscored.toLocal8Bit();
             }
 
             // index of wanted metrics
@@ -944,70 +1049,20 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
         // do we want metadata too ?
         foreach(QString meta, settings.metawanted) {
             meta.replace(" ", "_");
-            response.bwrite(", \"");
-            response.bwrite(meta.toLocal8Bit());
-            response.bwrite("\"");
+            out += ", \"";
+            out += meta.toLocal8Bit();
+            out += "\"";
         }
-        response.bwrite("\n");
-
-        // parse the rideDB and write a line for each entry
-        if (rideDB.exists() && rideDB.open(QFile::ReadOnly)) {
-
-            // ok, lets read it in
-            QTextStream stream(&rideDB);
-            stream.setCodec("UTF-8");
+        out += "\n";
 
-            // Read the entire file into a QString -- we avoid using fopen since it
-            // doesn't handle foreign characters well. Instead we use QFile and parse
-            // from a QString
-            QString contents = stream.readAll();
-            rideDB.close();
-
-            // create scanner context for reentrant parsing
-            RideDBContext *jc = new RideDBContext;
-            jc->cache = NULL;
-            jc->api = this;
-            jc->response = &response;
-            jc->request = &request;
-            jc->old = false;
-
-            // clean item
-            jc->item.path = home.absolutePath() + "/activities";
-            jc->item.context = NULL;
-            jc->item.isstale = jc->item.isdirty = jc->item.isedit = false;
-
-            RideDBlex_init(&scanner);
-
-            // inform the parser/lexer we have a new file
-            RideDB_setString(contents, scanner);
-
-            // setup
-            jc->errors.clear();
-
-            // parse it
-            RideDBparse(jc);
-
-            // clean up
-            RideDBlex_destroy(scanner);
-
-            // regardless of errors we're done !
-            delete jc;
-        }
+        // a line for each ride
+        foreach(RideItem *item, rides->rides)
+            writeRideLine(*item, since, before, settings, out);
 
     } else {
 
-        // honour the since parameter
-        QString sincep(request.getParameter("since"));
-        QDate since(1900,01,01);
-        if (sincep != "") since = QDate::fromString(sincep,"yyyy/MM/dd");
-
-        // before parameter
-        QString beforep(request.getParameter("before"));
-        QDate before(3000,01,01);
-        if (beforep != "") before = QDate::fromString(beforep,"yyyy/MM/dd");
-
         // fast list of rides by traversing the directory
-        response.bwrite("\n"); // headings have no metric columns
+        out += "\n"; // headings have no metric columns
 
         // This will read the user preferences and change the file list order as necessary:
         QFlags<QDir::Filter> spec = QDir::Files;
@@ -1029,14 +1084,16 @@ APIWebService::listRides(QString athlete, HttpRequest &request, HttpResponse &re
             if (name.endsWith(".bak")) continue;
 
             // out a line
-            response.bwrite(dateTime.date().toString("yyyy/MM/dd").toLocal8Bit());
-            response.bwrite(", ");
-            response.bwrite(dateTime.time().toString("hh:mm:ss").toLocal8Bit());;
-            response.bwrite(", ");
-            response.bwrite(name.toLocal8Bit());
-            response.bwrite("\n");
+            out += dateTime.date().toString("yyyy/MM/dd").toLocal8Bit();
+            out += ", ";
+            out += dateTime.time().toString("hh:mm:ss").toLocal8Bit();
+            out += ", ";
+            out += name.toLocal8Bit();
+            out += "\n";
         }
     }
-    response.flush();
+
+    cache(key, etag, out);
+    writeBody(request, response, out);
 }
 #endif
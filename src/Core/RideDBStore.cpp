@@ -0,0 +1,294 @@
+/*
+ * Copyright (c) 2018 GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "RideDBStore.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "IntervalItem.h"
+#include "RideMetric.h"
+#include "Context.h"
+#include "Athlete.h"
+#include "MainWindow.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDebug>
+#include <string.h>
+
+// the variable length data is written with a fixed stream version
+// so the store can be shared between Qt4 and Qt5 builds
+static const int storeStreamVersion = QDataStream::Qt_4_6;
+static const quint32 storeEndian = 0x01020304;
+
+QString
+RideDBStore::filename(Context *context)
+{
+    return QString("%1/%2").arg(context->athlete->home->cache().canonicalPath()).arg("rideDB.bin");
+}
+
+quint64
+RideDBStore::symbolsHash()
+{
+    // FNV-1a over the utf8 of each symbol, with a separator
+    quint64 hash = 14695981039346656037ULL;
+    foreach(const QString &symbol, RideMetricFactory::instance().allMetrics()) {
+        QByteArray bytes = symbol.toUtf8();
+        bytes.append('\0');
+        for (int i=0; i<bytes.size(); i++) {
+            hash ^= quint8(bytes.at(i));
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}
+
+bool
+RideDBStore::load(Context *context, RideCache *cache)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+
+    QFileInfo storeinfo(filename(context));
+    QFileInfo jsoninfo(QString("%1/%2").arg(context->athlete->home->cache().canonicalPath()).arg("rideDB.json"));
+
+    // no store, or rideDB.json was written after it (e.g. by an older
+    // version of GoldenCheetah that doesn't know about the store)
+    if (!storeinfo.exists()) return false;
+    if (jsoninfo.exists() && jsoninfo.lastModified() > storeinfo.lastModified()) return false;
+
+    QFile store(storeinfo.absoluteFilePath());
+    if (!store.open(QFile::ReadOnly)) return false;
+
+    qint64 size = store.size();
+    if (size < qint64(sizeof(RideDBStoreHeader))) return false;
+
+    // map it in, or if that isn't possible read it all in one go
+    QByteArray contents;
+    const uchar *base = store.map(0, size);
+    if (base == NULL) {
+        contents = store.readAll();
+        if (contents.size() != size) return false;
+        base = reinterpret_cast<const uchar*>(contents.constData());
+    }
+
+    // check it matches the metrics we have now, if they were
+    // added or changed we need the json since it is by symbol
+    const RideDBStoreHeader *header = reinterpret_cast<const RideDBStoreHeader*>(base);
+    quint64 rides = header->rides;
+    quint64 metrics = header->metrics;
+    if (memcmp(header->magic, RIDEDB_STORE_MAGIC, 4) || header->version != RIDEDB_STORE_VERSION ||
+        header->endian != storeEndian || header->schema != quint32(DBSchemaVersion) ||
+        header->userschema != quint32(UserMetricSchemaVersion) ||
+        metrics != quint64(factory.metricCount()) || header->symbols != symbolsHash() ||
+        header->records + (rides * sizeof(RideDBStoreRecord)) > quint64(size) ||
+        header->values + (rides * metrics * sizeof(double)) > quint64(size) ||
+        header->counts + (rides * metrics * sizeof(double)) > quint64(size) ||
+        header->strings > quint64(size)) {
+        return false;
+    }
+
+    const RideDBStoreRecord *records = reinterpret_cast<const RideDBStoreRecord*>(base + header->records);
+    const double *values = reinterpret_cast<const double*>(base + header->values);
+    const double *counts = reinterpret_cast<const double*>(base + header->counts);
+
+    QString path = context->athlete->home->activities().canonicalPath();
+
+    for (quint64 row=0; row < rides; row++) {
+
+        const RideDBStoreRecord &record = records[row];
+        if (header->strings + record.string + record.stringsize > quint64(size)) continue;
+
+        // a clean item to load into, same as the json parser
+        RideItem item;
+        item.path = path;
+        item.context = context;
+        item.isstale = item.isdirty = item.isedit = false;
+
+        item.dateTime = QDateTime::fromMSecsSinceEpoch(record.date).toLocalTime();
+        item.fingerprint = record.fingerprint;
+        item.crc = record.crc;
+        item.metacrc = record.metacrc;
+        item.timestamp = record.timestamp;
+        item.weight = record.weight;
+        item.dbversion = record.dbversion;
+        item.udbversion = record.udbversion;
+        item.zoneRange = record.zoneRange;
+        item.hrZoneRange = record.hrZoneRange;
+        item.paceZoneRange = record.paceZoneRange;
+        item.color = QColor::fromRgba(record.color);
+        item.isRun = record.isRun;
+        item.isSwim = record.isSwim;
+        item.samples = record.samples;
+
+        // metrics are a straight copy out of the matrix
+        memcpy(item.metrics().data(), values + (row * metrics), metrics * sizeof(double));
+        memcpy(item.counts().data(), counts + (row * metrics), metrics * sizeof(double));
+
+        // the rest is in the string table
+        QByteArray strings = QByteArray::fromRawData(reinterpret_cast<const char*>(base + header->strings + record.string),
+                                                     record.stringsize);
+        QDataStream in(&strings, QIODevice::ReadOnly);
+        in.setVersion(storeStreamVersion);
+
+        quint32 intervals;
+        in >> item.fileName >> item.present >> item.overrides_;
+        in >> item.metadata() >> item.xdata() >> item.stdmeans() >> item.stdvariances();
+        in >> intervals;
+
+        for (quint32 i=0; i<intervals && in.status() == QDataStream::Ok; i++) {
+
+            IntervalItem interval;
+            qint32 type;
+            in >> interval.name >> type >> interval.start >> interval.stop
+               >> interval.startKM >> interval.stopKM >> interval.displaySequence
+               >> interval.color >> interval.route >> interval.test
+               >> interval.metrics_ >> interval.count_ >> interval.stdmean_ >> interval.stdvariance_;
+            interval.type = static_cast<RideFileInterval::intervaltype>(type);
+
+            item.addInterval(interval);
+        }
+
+        if (in.status() != QDataStream::Ok) {
+            qDebug()<<"rideDB.bin corrupt at:"<<row;
+            return false;
+        }
+
+        RideItem *found = cache->getRide(item.fileName);
+        if (found) {
+
+            // progress update
+            if (context->mainWindow->progress) {
+
+                // percentage progress
+                QString m = QString("%1%")
+                .arg(double(context->mainWindow->loading++) /
+                     double(cache->rides().count()) * 100.0f, 0, 'f', 0);
+                context->mainWindow->progress->setText(m);
+                QApplication::processEvents();
+            }
+
+            // update from our loaded value
+            found->setFrom(item);
+
+        } else {
+            qDebug()<<"unable to load:"<<item.fileName<<item.dateTime<<item.weight;
+        }
+
+        // the intervals now belong to found, if anyone
+        item.clearIntervals();
+    }
+    return true;
+}
+
+void
+RideDBStore::save(Context *context, RideCache *cache)
+{
+    const RideMetricFactory &factory = RideMetricFactory::instance();
+    const int metrics = factory.metricCount();
+
+    QByteArray records, values, counts, strings;
+
+    foreach(RideItem *item, cache->rides()) {
+
+        // same rules as rideDB.json
+        if (item->metrics().count() == 0) continue;
+        if (item->skipsave == true) continue;
+
+        // variable length data first, we need its size
+        QByteArray data;
+        QDataStream out(&data, QIODevice::WriteOnly);
+        out.setVersion(storeStreamVersion);
+
+        out << item->fileName << item->present << item->overrides_;
+        out << item->metadata() << item->xdata() << item->stdmeans() << item->stdvariances();
+        out << quint32(item->intervals().count());
+        foreach(IntervalItem *interval, item->intervals()) {
+            out << interval->name << qint32(interval->type) << interval->start << interval->stop
+                << interval->startKM << interval->stopKM << interval->displaySequence
+                << interval->color << interval->route << interval->test
+                << interval->metrics_ << interval->count_ << interval->stdmean_ << interval->stdvariance_;
+        }
+
+        RideDBStoreRecord record;
+        memset(&record, 0, sizeof(record));
+        record.date = item->dateTime.toUTC().toMSecsSinceEpoch();
+        record.fingerprint = item->fingerprint;
+        record.crc = item->crc;
+        record.metacrc = item->metacrc;
+        record.timestamp = item->timestamp;
+        record.weight = item->weight;
+        record.string = strings.size();
+        record.stringsize = data.size();
+        record.dbversion = item->dbversion;
+        record.udbversion = item->udbversion;
+        record.zoneRange = item->zoneRange;
+        record.hrZoneRange = item->hrZoneRange;
+        record.paceZoneRange = item->paceZoneRange;
+        record.color = item->color.rgba();
+        record.isRun = item->isRun;
+        record.isSwim = item->isSwim;
+        record.samples = item->samples;
+
+        records.append(reinterpret_cast<const char*>(&record), sizeof(record));
+        strings.append(data);
+
+        // one row of the matrix, zero any metrics not computed yet
+        QVector<double> row(metrics, 0.0), count(metrics, 0.0);
+        for (int i=0; i<metrics && i<item->metrics().count(); i++) row[i] = item->metrics()[i];
+        for (int i=0; i<metrics && i<item->counts().count(); i++) count[i] = item->counts()[i];
+        values.append(reinterpret_cast<const char*>(row.constData()), metrics * sizeof(double));
+        counts.append(reinterpret_cast<const char*>(count.constData()), metrics * sizeof(double));
+    }
+
+    RideDBStoreHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RIDEDB_STORE_MAGIC, 4);
+    header.version = RIDEDB_STORE_VERSION;
+    header.endian = storeEndian;
+    header.schema = DBSchemaVersion;
+    header.userschema = UserMetricSchemaVersion;
+    header.metrics = metrics;
+    header.symbols = symbolsHash();
+    header.rides = records.size() / sizeof(RideDBStoreRecord);
+
+    // record and matrix sizes are multiples of 8 so the
+    // doubles stay aligned when the file is mapped
+    header.records = sizeof(header);
+    header.values = header.records + records.size();
+    header.counts = header.values + values.size();
+    header.strings = header.counts + counts.size();
+
+    // write to a temporary file and then replace, so a
+    // crash mid-write doesn't leave a corrupt store
+    QString name = filename(context);
+    QFile store(name + ".tmp");
+    if (!store.open(QFile::WriteOnly | QFile::Truncate)) return;
+
+    bool ok = store.write(reinterpret_cast<const char*>(&header), sizeof(header)) == sizeof(header) &&
+              store.write(records) == records.size() &&
+              store.write(values) == values.size() &&
+              store.write(counts) == counts.size() &&
+              store.write(strings) == strings.size();
+    store.close();
+
+    QFile::remove(name);
+    if (!ok || !store.rename(name)) {
+        store.remove();
+        qDebug()<<"unable to write:"<<name;
+    }
+}
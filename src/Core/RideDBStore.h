@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2018 GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_RideDBStore_h
+#define _GC_RideDBStore_h 1
+#include "GoldenCheetah.h"
+
+#include <QString>
+#include <QtGlobal>
+
+class RideCache;
+class Context;
+
+// The binary ride store (cache/rideDB.bin) holds the same data as
+// cache/rideDB.json but in a form that can be memory mapped and read
+// without parsing; a fixed width record per ride, a matrix of metric
+// values and counts indexed by RideMetric::index() and a string table
+// holding the variable length data (metadata, xdata, intervals).
+//
+// It is written alongside rideDB.json and only used when it matches the
+// current metric schema exactly, with the same metrics in the same columns,
+// and is no older than rideDB.json, in all other cases we fall back to
+// parsing the json.
+//
+// change history
+// version  date       what
+// 1        Oct 18     initial version
+// 2        Oct 18     hash of the metric symbols in column order
+
+#define RIDEDB_STORE_VERSION 2
+#define RIDEDB_STORE_MAGIC "GCRB"
+
+// header at the start of the file, offsets are from the start of the file
+struct RideDBStoreHeader {
+    char magic[4];              // RIDEDB_STORE_MAGIC
+    quint32 version;            // RIDEDB_STORE_VERSION
+    quint32 endian;             // 0x01020304 when written
+    quint32 schema;             // DBSchemaVersion
+    quint32 userschema;         // UserMetricSchemaVersion
+    quint32 metrics;            // number of metrics per ride (columns)
+    quint32 rides;              // number of rides (rows)
+    quint32 reserved;
+    quint64 records;            // offset of RideDBStoreRecord[rides]
+    quint64 values;             // offset of double[rides][metrics]
+    quint64 counts;             // offset of double[rides][metrics]
+    quint64 strings;            // offset of the string table
+    quint64 symbols;            // hash of the metric symbols in column order
+};
+
+// fixed width record per ride, ordered by size to avoid padding
+struct RideDBStoreRecord {
+    qint64 date;                // msecs since epoch, UTC
+    quint64 fingerprint, crc, metacrc, timestamp;
+    double weight;
+    quint64 string;             // offset into the string table
+    quint32 stringsize;
+    qint32 dbversion, udbversion;
+    qint32 zoneRange, hrZoneRange, paceZoneRange;
+    quint32 color;              // QRgb
+    quint8 isRun, isSwim, samples, reserved;
+};
+
+class RideDBStore
+{
+    public:
+
+        // returns false if the store is missing or stale, the caller
+        // should then fall back to reading rideDB.json
+        static bool load(Context *context, RideCache *cache);
+
+        // write the store from the current cache contents
+        static void save(Context *context, RideCache *cache);
+
+        static QString filename(Context *context);
+
+    private:
+
+        // hash of the metric symbols in index order, since the columns
+        // depend on the order metrics are registered and the user metrics
+        static quint64 symbolsHash();
+};
+
+#endif // _GC_RideDBStore_h
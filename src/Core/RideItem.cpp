@@ -24,6 +24,8 @@
 #include "IntervalItem.h"
 #include "Route.h"
 #include "Context.h"
+#include "Athlete.h"
+#include "RideCache.h"
 #include "Zones.h"
 #include "HrZones.h"
 #include "PaceZones.h"
@@ -421,6 +423,9 @@ RideItem::setFileName(QString path, QString fileName)
 {
     this->path = path;
     this->fileName = fileName;
+
+    // the cache looks us up by name
+    if (context && context->athlete && context->athlete->rideCache) context->athlete->rideCache->invalidateIndexes();
 }
 
 bool
@@ -452,11 +457,14 @@ RideItem::setStartTime(QDateTime newDateTime)
 {
     dateTime = newDateTime;
     ride()->setStartTime(newDateTime);
+
+    // and by start time
+    if (context && context->athlete && context->athlete->rideCache) context->athlete->rideCache->invalidateIndexes();
 }
 
 // check if we need to be refreshed
 bool
-RideItem::checkStale()
+RideItem::checkStale(RideCacheFingerprints *fingerprints)
 {
     // if we're marked stale already then just return that !
     if (isstale) return true;
@@ -491,13 +499,9 @@ RideItem::checkStale()
             // HRV fingerprint added to detect changes on HRV Measures
 
             // get the new zone configuration fingerprint that applies for the ride date
-            unsigned long rfingerprint = static_cast<unsigned long>(context->athlete->zones(isRun)->getFingerprint(dateTime.date()))
-                        + (appsettings->cvalue(context->athlete->cyclist, context->athlete->zones(isRun)->useCPforFTPSetting(), 0).toInt() ? 1 : 0)
-                        + static_cast<unsigned long>(context->athlete->paceZones(isSwim)->getFingerprint(dateTime.date()))
-                        + static_cast<unsigned long>(context->athlete->hrZones(isRun)->getFingerprint(dateTime.date()))
-                        + static_cast<unsigned long>(context->athlete->routes->getFingerprint())
-                        + static_cast<unsigned long>(getHrvFingerprint())
-                        + appsettings->cvalue(context->athlete->cyclist, GC_DISCOVERY, 57).toInt(); // 57 does not include search for PEAKS
+            // when checking all the rides it is shared by the rides in the same ranges
+            unsigned long rfingerprint = (fingerprints ? fingerprints->fingerprint(this) : getConfigFingerprint())
+                        + static_cast<unsigned long>(getHrvFingerprint());
 
             if (fingerprint != rfingerprint) {
 
@@ -633,17 +637,14 @@ RideItem::refresh()
                 count_[j] = 0.00f;
             }
 
+        // any aggregates the cache holds are now out of date
+        if (context->athlete->rideCache) context->athlete->rideCache->invalidateMetrics();
+
         // Update auto intervals AFTER ridefilecache as used for bests
         updateIntervals();
 
         // update fingerprints etc, crc done above
-        fingerprint = static_cast<unsigned long>(context->athlete->zones(isRun)->getFingerprint(dateTime.date()))
-                    + (appsettings->cvalue(context->athlete->cyclist, context->athlete->zones(isRun)->useCPforFTPSetting(), 0).toInt() ? 1 : 0)
-                    + static_cast<unsigned long>(context->athlete->paceZones(isSwim)->getFingerprint(dateTime.date()))
-                    + static_cast<unsigned long>(context->athlete->hrZones(isRun)->getFingerprint(dateTime.date()))
-                    + static_cast<unsigned long>(context->athlete->routes->getFingerprint()) +
-                    + static_cast<unsigned long>(getHrvFingerprint())
-                    + appsettings->cvalue(context->athlete->cyclist, GC_DISCOVERY, 57).toInt(); // 57 does not include search for PEAKS
+        fingerprint = getConfigFingerprint() + static_cast<unsigned long>(getHrvFingerprint());
 
         dbversion = DBSchemaVersion;
         udbversion = UserMetricSchemaVersion;
@@ -715,6 +716,19 @@ RideItem::getWeight(int type)
     return weight;
 }
 
+// everything but the hrv fingerprint depends upon the zone ranges the
+// ride falls in rather than the ride itself
+unsigned long
+RideItem::getConfigFingerprint()
+{
+    return static_cast<unsigned long>(context->athlete->zones(isRun)->getFingerprint(dateTime.date()))
+           + (appsettings->cvalue(context->athlete->cyclist, context->athlete->zones(isRun)->useCPforFTPSetting(), 0).toInt() ? 1 : 0)
+           + static_cast<unsigned long>(context->athlete->paceZones(isSwim)->getFingerprint(dateTime.date()))
+           + static_cast<unsigned long>(context->athlete->hrZones(isRun)->getFingerprint(dateTime.date()))
+           + static_cast<unsigned long>(context->athlete->routes->getFingerprint())
+           + appsettings->cvalue(context->athlete->cyclist, GC_DISCOVERY, 57).toInt(); // 57 does not include search for PEAKS
+}
+
 double
 RideItem::getHrvMeasure(int type)
 {
@@ -954,19 +968,21 @@ RideItem::updateIntervals()
                                 tr("1 minute"), tr("5 minutes"), tr("10 minutes"), tr("20 minutes"), tr("30 minutes"), tr("45 minutes"),
                                 tr("1 hour") };
     
-        for(int i=0; durations[i] != 0; i++) {
+        // go hunting for best peaks, all durations at once
+        QVector<double> windows;
+        for(int i=0; durations[i] != 0; i++) windows << durations[i];
+        QVector<AddIntervalDialog::AddedInterval> results;
+        AddIntervalDialog::findPeaks(f, Specification(), RideFile::watts, windows, results);
 
-            // go hunting for best peak
-            QList<AddIntervalDialog::AddedInterval> results;
-            AddIntervalDialog::findPeaks(context, true, f, Specification(), RideFile::watts, RideFile::original, durations[i], 1, results, "", "");
+        for(int i=0; durations[i] != 0; i++) {
 
             // did we get one ?
-            if (results.count() > 0 && results[0].avg > 0 && results[0].stop > 0) {
-                // qDebug()<<"found"<<names[i]<<"peak power"<<results[0].start<<"-"<<results[0].stop<<"of"<<results[0].avg<<"watts";
-                IntervalItem *intervalItem = new IntervalItem(this, QString(tr("%1 (%2 watts)")).arg(names[i]).arg(int(results[0].avg)),
-                                                            results[0].start, results[0].stop, 
-                                                            f->timeToDistance(results[0].start),
-                                                            f->timeToDistance(results[0].stop),
+            if (results[i].avg > 0 && results[i].stop > 0) {
+                // qDebug()<<"found"<<names[i]<<"peak power"<<results[i].start<<"-"<<results[i].stop<<"of"<<results[i].avg<<"watts";
+                IntervalItem *intervalItem = new IntervalItem(this, QString(tr("%1 (%2 watts)")).arg(names[i]).arg(int(results[i].avg)),
+                                                            results[i].start, results[i].stop, 
+                                                            f->timeToDistance(results[i].start),
+                                                            f->timeToDistance(results[i].stop),
                                                             count++,
                                                             QColor(Qt::gray),
                                                             false,
@@ -989,21 +1005,23 @@ RideItem::updateIntervals()
                                 tr("1 hour") };
 
         bool metric = appsettings->value(this, context->athlete->paceZones(f->isSwim())->paceSetting(), true).toBool();
-        for(int i=0; durations[i] != 0; i++) {
+        // go hunting for best peaks, all durations at once
+        QVector<double> windows;
+        for(int i=0; durations[i] != 0; i++) windows << durations[i];
+        QVector<AddIntervalDialog::AddedInterval> results;
+        AddIntervalDialog::findPeaks(f, Specification(), RideFile::kph, windows, results);
 
-            // go hunting for best peak
-            QList<AddIntervalDialog::AddedInterval> results;
-            AddIntervalDialog::findPeaks(context, true, f, Specification(), RideFile::kph, RideFile::original, durations[i], 1, results, "", "");
+        for(int i=0; durations[i] != 0; i++) {
 
             // did we get one ?
-            if (results.count() > 0 && results[0].avg > 0 && results[0].stop > 0) {
-                // qDebug()<<"found"<<names[i]<<"peak pace"<<results[0].start<<"-"<<results[0].stop<<"of"<<results[0].avg<<"kph";
+            if (results[i].avg > 0 && results[i].stop > 0) {
+                // qDebug()<<"found"<<names[i]<<"peak pace"<<results[i].start<<"-"<<results[i].stop<<"of"<<results[i].avg<<"kph";
                 IntervalItem *intervalItem = new IntervalItem(this, QString(tr("%1 (%2 %3)")).arg(names[i])
-                               .arg(context->athlete->paceZones(f->isSwim())->kphToPaceString(results[0].avg, metric))
+                               .arg(context->athlete->paceZones(f->isSwim())->kphToPaceString(results[i].avg, metric))
                                .arg(context->athlete->paceZones(f->isSwim())->paceUnits(metric)),
-                                                            results[0].start, results[0].stop, 
-                                                            f->timeToDistance(results[0].start),
-                                                            f->timeToDistance(results[0].stop),
+                                                            results[i].start, results[i].stop, 
+                                                            f->timeToDistance(results[i].start),
+                                                            f->timeToDistance(results[i].stop),
                                                             count++,
                                                             QColor(Qt::gray),
                                                             false,
@@ -38,6 +38,7 @@ class IntervalSummaryWindow;
 class Context;
 class UserData;
 class ComparePane;
+class RideCacheFingerprints;
 
 Q_DECLARE_METATYPE(RideItem*)
 
@@ -166,6 +167,7 @@ class RideItem : public QObject
         double getWeight(int type=0);
         double getHrvMeasure(int type=HrvMeasure::RMSSD);
         unsigned short getHrvFingerprint();
+        unsigned long getConfigFingerprint(); // zones, cp, routes and discovery
 
         // when retrieving interval lists we can provide criteria too
         QList<IntervalItem*> &intervals()  { return intervals_; }
@@ -202,7 +204,7 @@ class RideItem : public QObject
         // state
         void setDirty(bool);
         bool isDirty() { return isdirty; }
-        bool checkStale(); // check if we need to refresh
+        bool checkStale(RideCacheFingerprints *fingerprints=NULL); // check if we need to refresh
         bool isStale() { return isstale; }
 
         // refresh when stale
@@ -124,8 +124,51 @@ RouteSegment::addPoint(RoutePoint _point)
     return points.count();
 }
 
+//  This function converts decimal degrees to radians
+double deg2rad(double deg) {
+  return (deg * pi / 180);
+}
+
+// This function converts radians to decimal degrees
+double rad2deg(double rad) {
+  return (rad * 180 / pi);
+}
+
+RouteRidePoints::RouteRidePoints(RideFile *ride)
+{
+    sinlat.resize(ride->dataPoints().count());
+    coslat.resize(ride->dataPoints().count());
+
+    for (int i=0; i<ride->dataPoints().count(); i++) {
+        double lat = deg2rad(ride->dataPoints().at(i)->lat);
+        sinlat[i] = sin(lat);
+        coslat[i] = cos(lat);
+    }
+}
+
+// same as RouteSegment::distance, to the bit, but using the sine and
+// cosine of the latitudes already worked out
+static inline double
+routeDistance(const RoutePoint &routepoint, double sinlat1, double coslat1,
+              const RideFilePoint *point, double sinlat2, double coslat2)
+{
+    double _theta = routepoint.lon - point->lon;
+    if (_theta == 0 && (routepoint.lat - point->lat) == 0) return 0;
+
+    return acos(sinlat1 * sinlat2 + coslat1 * coslat2 * cos(deg2rad(_theta))) * 6371;
+}
+
+// the distance along a meridian is as close as two points can be with
+// that difference in latitude, so if it is further than some distance
+// (with 10m to spare for rounding) we don't need the real distance
+static inline bool
+routeFurther(const RoutePoint &routepoint, const RideFilePoint *point, double distance)
+{
+    return fabs(deg2rad(routepoint.lat - point->lat)) * 6371 > distance + 0.01;
+}
+
 void 
-RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
+RouteSegment::search(RideItem *item, RideFile*ride, const RouteRidePoints &ridepoints, QList<IntervalItem*>&here)
 {
     //qDebug() << "Opening ride: " << item->fileName << " for " << name;
 
@@ -142,6 +185,13 @@ RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
     int lastpoint = -1; // Last point to match
     double start = -1, stop = -1; // Start and stop secs
 
+    // the route point latitudes, as for the ride
+    QVector<double> sinlat(points.count()), coslat(points.count());
+    for (int n=0; n<points.count(); n++) {
+        sinlat[n] = sin(deg2rad(points.at(n).lat));
+        coslat[n] = cos(deg2rad(points.at(n).lat));
+    }
+
     for (int n=0; n< this->getPoints().count();n++) {
         RoutePoint routepoint = this->getPoints().at(n);
 
@@ -159,8 +209,15 @@ RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
                 // Valid GPS value
                 if (start == -1) {
                     diverge = 0;
+
+                    // clearly far away from reference point
+                    if (routeFurther(routepoint, point, 1)) {
+                        i += 50;
+                        continue;
+                    }
+
                     // Calculate distance to route point
-                    double _dist = distance(routepoint.lat, routepoint.lon, point->lat, point->lon) ;
+                    double _dist = routeDistance(routepoint, sinlat[n], coslat[n], point, ridepoints.sinlat[i], ridepoints.coslat[i]);
                     minimumdistance = _dist;
 
                     if (precision == -1 || _dist<precision)
@@ -183,7 +240,12 @@ RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
                         RideFilePoint* nextpoint = ride->dataPoints().at(j);
 
                         if (nextpoint->lat != 0 && nextpoint->lon !=0 && ceil(nextpoint->lat) != 180 && ceil(nextpoint->lon) != 180) {
-                            double _nextdist = distance(routepoint.lat, routepoint.lon, nextpoint->lat, nextpoint->lon) ;
+
+                            // too far away to be closer or within precision
+                            if (minimumdistance != -1 && routeFurther(routepoint, nextpoint, qMax(minimumdistance, minimumprecision)))
+                                continue;
+
+                            double _nextdist = routeDistance(routepoint, sinlat[n], coslat[n], nextpoint, ridepoints.sinlat[j], ridepoints.coslat[j]);
 
                             if (minimumdistance ==-1 || _nextdist<minimumdistance){
                                 //new minimumdistance
@@ -277,16 +339,6 @@ RouteSegment::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
 }
 
 
-//  This function converts decimal degrees to radians
-double deg2rad(double deg) {
-  return (deg * pi / 180);
-}
-
-// This function converts radians to decimal degrees
-double rad2deg(double rad) {
-  return (rad * 180 / pi);
-}
-
 // lat1, lon1 = point 1, Latitude and Longitude of
 // lat2, lon2 = Latitude and Longitude of point 2
 double
@@ -406,18 +458,29 @@ Routes::search(RideItem *item, RideFile*ride, QList<IntervalItem*>&here)
 {
     if (ride) {
 
+        double minLat = ride->getMinPoint(RideFile::lat).toDouble();
+        double maxLat = ride->getMaxPoint(RideFile::lat).toDouble();
+        double minLon = ride->getMinPoint(RideFile::lon).toDouble();
+        double maxLon = ride->getMaxPoint(RideFile::lon).toDouble();
+
+        // only worked out if a segment is within the ride
+        RouteRidePoints *ridepoints = NULL;
+
         // search all segments
         for (int routecount=0;routecount<routes.count();routecount++) {
             RouteSegment *segment = &routes[routecount];
 
             // The third decimal place is worth up to 110 m
-            if (ride->getMinPoint(RideFile::lat).toDouble()<segment->getMinLat()+0.001 &&
-                ride->getMaxPoint(RideFile::lat).toDouble()>segment->getMaxLat()-0.001 &&
-                ride->getMinPoint(RideFile::lon).toDouble()<segment->getMinLon()+0.001 &&
-                ride->getMaxPoint(RideFile::lon).toDouble()>segment->getMaxLon()-0.001   )
+            if (minLat<segment->getMinLat()+0.001 &&
+                maxLat>segment->getMaxLat()-0.001 &&
+                minLon<segment->getMinLon()+0.001 &&
+                maxLon>segment->getMaxLon()-0.001   ) {
 
-            segment->search(item, ride, here);
+                if (ridepoints == NULL) ridepoints = new RouteRidePoints(ride);
+                segment->search(item, ride, *ridepoints, here);
+            }
         }
+        delete ridepoints;
     }
 }
 
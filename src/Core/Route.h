@@ -31,6 +31,7 @@
 class  RideFile;
 class  Routes;
 struct RoutePoint;
+struct RouteRidePoints;
 
 class RouteSegment // represents a segment we match against
 {
@@ -60,7 +61,7 @@ class RouteSegment // represents a segment we match against
         double distance(double lat1, double lon1, double lat2, double lon2);
 
         // find segments in ridefiles
-        void search(RideItem *, RideFile*, QList<IntervalItem*>&);
+        void search(RideItem *, RideFile*, const RouteRidePoints &, QList<IntervalItem*>&);
 
     private:
 
@@ -82,6 +83,16 @@ struct RoutePoint // represents a point within a segment
     double lon, lat;
 };
 
+// the sine and cosine of the latitude of every sample in a ride, they
+// are most of the cost of working out the distance to a route point so
+// they are worked out once per ride and shared by all the segments
+struct RouteRidePoints
+{
+    RouteRidePoints(RideFile *ride);
+
+    QVector<double> sinlat, coslat;
+};
+
 
 class Routes : public QObject { // top-level object with API and map of segments/rides
 
@@ -71,6 +71,9 @@ class FilterSet
         }
 
         int count() { return filters_.count(); }
+
+        // the filters, each a list of filenames
+        QVector<QStringList> filters() const { return filters_; }
 };
 
 class RideFileIterator;
@@ -0,0 +1,114 @@
+/*
+ * Copyright (c) 2018 GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "TaskPool.h"
+
+#include <QThreadPool>
+#include <QList>
+
+// tasks waiting to run, for all groups, oldest first
+struct QueuedTask {
+    QRunnable *task;
+    TaskGroup *group;
+};
+static QMutex queueLock;
+static QList<QueuedTask> queue;
+
+// posted to the thread pool for every task submitted, it runs
+// the oldest task queued, which may not be the one it was posted
+// for (a waiting thread may have run that already), or nothing
+class TaskPump : public QRunnable
+{
+    public:
+        void run() {
+            queueLock.lock();
+            if (queue.isEmpty()) {
+                queueLock.unlock();
+                return;
+            }
+            QueuedTask next = queue.takeFirst();
+            queueLock.unlock();
+
+            TaskGroup::execute(next.task, next.group);
+        }
+};
+
+TaskGroup::TaskGroup() : pending(0)
+{
+}
+
+TaskGroup::~TaskGroup()
+{
+    wait();
+}
+
+void
+TaskGroup::submit(QRunnable *task)
+{
+    QueuedTask add;
+    add.task = task;
+    add.group = this;
+
+    queueLock.lock();
+    queue.append(add);
+    pending++;
+
+    // if we're waiting, this may be a task submitted by one
+    // of our tasks that the waiting thread should pick up
+    changed.wakeAll();
+    queueLock.unlock();
+
+    QThreadPool::globalInstance()->start(new TaskPump);
+}
+
+void
+TaskGroup::execute(QRunnable *task, TaskGroup *group)
+{
+    bool autodelete = task->autoDelete();
+    task->run();
+    if (autodelete) delete task;
+
+    queueLock.lock();
+    if (--group->pending == 0) group->changed.wakeAll();
+    queueLock.unlock();
+}
+
+void
+TaskGroup::wait()
+{
+    queueLock.lock();
+    while (pending) {
+
+        // run our newest task that hasn't started, if there is one
+        int index;
+        for (index=queue.count()-1; index >= 0; index--)
+            if (queue[index].group == this) break;
+
+        if (index >= 0) {
+            QueuedTask next = queue.takeAt(index);
+            queueLock.unlock();
+            execute(next.task, this);
+            queueLock.lock();
+            continue;
+        }
+
+        // the rest are running elsewhere
+        changed.wait(&queueLock);
+    }
+    queueLock.unlock();
+}
@@ -0,0 +1,69 @@
+/*
+ * Copyright (c) 2018 GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_TaskPool_h
+#define _GC_TaskPool_h 1
+#include "GoldenCheetah.h"
+
+#include <QRunnable>
+#include <QMutex>
+#include <QWaitCondition>
+
+// Short lived jobs (a mean max for one series of one ride, one start
+// of a model fit) used to get their own QThread, and when the ride cache
+// refreshes every ride at once in the global thread pool that meant
+// hundreds of threads and more time creating them than doing the work.
+//
+// A TaskGroup runs its tasks on the global QThreadPool, the same threads
+// QtConcurrent uses, so the process never has more threads busy than it
+// has cores. Tasks can submit tasks of their own. Whilst waiting for a
+// group the caller runs any of its tasks that haven't been picked up yet,
+// newest first, so waiting from inside a pool thread can't deadlock when
+// every pool thread is busy, and idle pool threads take the oldest tasks
+// from any group.
+//
+// e.g.
+//      TaskGroup group;
+//      foreach(RideFile::SeriesType series, wanted) group.submit(new Computer(series));
+//      group.wait();
+
+class TaskGroup
+{
+    public:
+
+        TaskGroup();
+        ~TaskGroup(); // waits for any tasks still running
+
+        // queue a task, it is deleted once run if autoDelete() is set
+        void submit(QRunnable *task);
+
+        // wait for every task submitted so far to complete
+        void wait();
+
+    private:
+
+        friend class TaskPump;
+
+        // run a task taken from the queue and account for it
+        static void execute(QRunnable *task, TaskGroup *group);
+
+        int pending; // submitted but not completed, guarded by the queue lock
+        QWaitCondition changed;
+};
+
+#endif // _GC_TaskPool_h
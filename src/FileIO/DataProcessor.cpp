@@ -52,21 +52,83 @@ DataProcessorFactory::autoProcess(RideFile *ride, QString mode, QString op)
 
     bool changed = false;
 
+    // when are they applied? no need to look every time
+    if (applies.isEmpty()) {
+        foreach(QString name, processors.keys()) {
+            QString configsetting = QString("dp/%1/apply").arg(name);
+            applies.insert(name, appsettings->value(NULL, GC_QSETTINGS_GLOBAL_GENERAL+configsetting, "Manual").toString());
+        }
+    }
+
+    // stages waiting to be run together
+    QList<DataProcessor*> stages;
+
     // run through the processors and execute them!
     QMapIterator<QString, DataProcessor*> i(processors);
     i.toFront();
     while (i.hasNext()) {
         i.next();
-        QString configsetting = QString("dp/%1/apply").arg(i.key());
 
         // if we're being run manually, run all that are defined
-        if (appsettings->value(NULL, GC_QSETTINGS_GLOBAL_GENERAL+configsetting, "Manual").toString() == mode)
+        if (applies.value(i.key()) == mode) {
+
+            if (i.value()->isStage()) {
+                stages << i.value();
+                continue;
+            }
+
+            // the stages before this one go first
+            if (stages.count()) runStages(ride, stages, NULL, op);
+            stages.clear();
+
+            // processors may write to the points directly, so
+            // the next one must not see stale columns
             i.value()->postProcess(ride, NULL, op);
+            ride->invalidateColumns();
+        }
     }
+    if (stages.count()) runStages(ride, stages, NULL, op);
 
     return changed;
 }
 
+bool
+DataProcessorFactory::runStages(RideFile *ride, QList<DataProcessor*> stages, DataProcessorConfig *config, QString op)
+{
+    // which have anything to do, and what do they change
+    QList<DataProcessor*> running;
+    QList<RideFile::SeriesType> series;
+    QStringList names;
+    foreach(DataProcessor *stage, stages) {
+        if (!stage->startStage(ride, config, op)) continue;
+
+        running << stage;
+        names << stage->name();
+        foreach(RideFile::SeriesType x, stage->writes())
+            if (!series.contains(x)) series << x;
+    }
+    if (running.isEmpty()) return false;
+
+    // one pass, each stage sees the changes made by those before it
+    int count = ride->dataPoints().count();
+    QVector<QVector<double> > values(series.count(), QVector<double>(count));
+    for (int i=0; i<count; i++) {
+        RideFilePoint point = *ride->dataPoints()[i];
+
+        foreach(DataProcessor *stage, running) stage->processSample(point);
+        for (int k=0; k<series.count(); k++) values[k][i] = point.value(series[k]);
+    }
+
+    // update each series in one go
+    ride->command->startLUW(names.join(", "));
+    for (int k=0; k<series.count(); k++) ride->command->setPointValues(0, series[k], values[k]);
+    ride->command->endLUW();
+
+    foreach(DataProcessor *stage, running) stage->endStage(ride);
+    ride->invalidateColumns();
+    return true;
+}
+
 ManualDataProcessorDialog::ManualDataProcessorDialog(Context *context, QString name, RideItem *ride) : context(context), ride(ride)
 {
     setAttribute(Qt::WA_DeleteOnClose);
@@ -126,6 +188,7 @@ ManualDataProcessorDialog::okClicked()
     QApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
 
     if (ride && ride->ride() && processor->postProcess((RideFile *)ride->ride(), config, "UPDATE") == true) {
+        ride->ride()->invalidateColumns();
         context->notifyRideSelected(ride);     // to remain compatible with rest of GC for now
     }
 
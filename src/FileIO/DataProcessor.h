@@ -78,6 +78,17 @@ class DataProcessor
         virtual bool postProcess(RideFile *, DataProcessorConfig*settings=0, QString op="") = 0;
         virtual DataProcessorConfig *processorConfig(QWidget *parent) = 0;
         virtual QString name() = 0; // Localized Name for user interface
+
+        // processors that change each sample using only the values of that
+        // sample can run as a stage, so when run automatically they share a
+        // single pass over the samples with the other stages next to them.
+        // startStage returns false if there is nothing to do for this ride,
+        // and only the series the stage writes are updated.
+        virtual bool isStage() { return false; }
+        virtual QList<RideFile::SeriesType> writes() { return QList<RideFile::SeriesType>(); }
+        virtual bool startStage(RideFile *, DataProcessorConfig *, QString) { return false; }
+        virtual void processSample(RideFilePoint &) {}
+        virtual void endStage(RideFile *) {}
 };
 
 // all data processors
@@ -88,6 +99,7 @@ class DataProcessorFactory {
         static DataProcessorFactory *instance_;
         static bool autoprocess;
         QMap<QString,DataProcessor*> processors;
+        QMap<QString,QString> applies; // dp/name/apply settings, read once
         DataProcessorFactory() {}
 
 
@@ -98,6 +110,10 @@ class DataProcessorFactory {
         QMap<QString,DataProcessor*> getProcessors() const { return processors; }
         bool autoProcess(RideFile *, QString mode, QString op); // run auto processes (after open rideFile)
         void setAutoProcessRule(bool b) { autoprocess = b; } // allows to switch autoprocess off (e.g. for Upgrades)
+        void configChanged() { applies.clear(); } // when the apply settings are changed
+
+        // run stages in a single pass over the samples
+        static bool runStages(RideFile *, QList<DataProcessor*> stages, DataProcessorConfig *config, QString op);
 };
 
 class Context;
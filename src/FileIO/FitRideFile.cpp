@@ -31,6 +31,7 @@
 #include <cstdio>
 #include <stdint.h>
 #include <time.h>
+#include <string.h>
 #include <limits>
 #include <cmath>
 
@@ -110,6 +111,9 @@ struct FitValue
 struct FitFileReaderState
 {
     QFile &file;
+    QByteArray contents;
+    const char *data;
+    qint64 size, pos;
     QStringList &errors;
     RideFile *rideFile;
     time_t start_time;
@@ -118,7 +122,8 @@ struct FitFileReaderState
     quint32 last_event_timestamp;
     double start_timestamp;
     double last_distance;
-    QMap<int, FitDefinition> local_msg_types;
+    FitDefinition local_msg_types[16]; // local message types are 4 bits
+    bool local_msg_defined[16];
     QMap<QString, FitDeveField>  local_deve_fields; // All developer fields
     QMap<int, int> record_extra_fields;
     QMap<QString, int> record_deve_fields; // Developer fields in DEVELOPER XDATA or STANDARD DATA
@@ -148,31 +153,47 @@ struct FitFileReaderState
     QList<QString> dataInfos;
 
     FitFileReaderState(QFile &file, QStringList &errors) :
-        file(file), errors(errors), rideFile(NULL), start_time(0),
+        file(file), data(NULL), size(0), pos(0), errors(errors), rideFile(NULL), start_time(0),
         last_time(0), last_distance(0.00f), interval(0), calibration(0),
         devices(0), stopped(true), isLapSwim(false), pool_length(0.0),
         last_event_type(-1), last_event(-1), last_msg_type(-1), frac_time(0.0),
         last_lap_end(0.0)
-    {}
+    {
+        for (int i=0; i<16; i++) local_msg_defined[i] = false;
+    }
 
     struct TruncatedRead {};
 
-    void read_unknown( int size, int *count = NULL ) {
-        if (!file.seek(file.pos() + size))
+    // what QFile::canReadLine() told us when reading from the file
+    bool more() const {
+        return pos < size && memchr(data + pos, '\n', size - pos) != NULL;
+    }
+
+    // the whole file is read into memory (or mapped) once and the
+    // fields are decoded from there, reading a field at a time
+    // through QFile is very slow for large imports
+    const char *read_bytes(int len, int *count = NULL) {
+        if (pos + len > size)
             throw TruncatedRead();
+        const char *p = data + pos;
+        pos += len;
+        if (count)
+            (*count) += len;
+        return p;
+    }
+
+    void read_unknown( int size, int *count = NULL ) {
+        // like seeking a file, skipping past the end isn't an error
+        // but the next read will be
+        pos += size;
         if (count)
             (*count) += size;
     }
 
     fit_string_value read_text(int len, int *count = NULL) {
-        char c;
         fit_string_value res = "";
         for (int i = 0; i < len; ++i) {
-            if (file.read(&c, 1) != 1)
-                throw TruncatedRead();
-            if (count)
-                *count += 1;
-
+            char c = *read_bytes(1, count);
             if (c != 0)
                 res += c;
         }
@@ -181,40 +202,28 @@ struct FitFileReaderState
 
     fit_value_t read_int8(int *count = NULL) {
         qint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
+        memcpy(&i, read_bytes(1, count), 1);
 
         return i == 0x7f ? NA_VALUE : i;
     }
 
     fit_value_t read_uint8(int *count = NULL) {
         quint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
+        memcpy(&i, read_bytes(1, count), 1);
 
         return i == 0xff ? NA_VALUE : i;
     }
 
     fit_value_t read_uint8z(int *count = NULL) {
         quint8 i;
-        if (file.read(reinterpret_cast<char*>( &i), 1) != 1)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 1;
+        memcpy(&i, read_bytes(1, count), 1);
 
         return i == 0x00 ? NA_VALUE : i;
     }
 
     fit_value_t read_int16(bool is_big_endian, int *count = NULL) {
         qint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
+        memcpy(&i, read_bytes(2, count), 2);
 
         i = is_big_endian
             ? qFromBigEndian<qint16>( i )
@@ -225,10 +234,7 @@ struct FitFileReaderState
 
     fit_value_t read_uint16(bool is_big_endian, int *count = NULL) {
         quint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
+        memcpy(&i, read_bytes(2, count), 2);
 
         i = is_big_endian
             ? qFromBigEndian<quint16>( i )
@@ -239,10 +245,7 @@ struct FitFileReaderState
 
     fit_value_t read_uint16z(bool is_big_endian, int *count = NULL) {
         quint16 i;
-        if (file.read(reinterpret_cast<char*>(&i), 2) != 2)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 2;
+        memcpy(&i, read_bytes(2, count), 2);
 
         i = is_big_endian
             ? qFromBigEndian<quint16>( i )
@@ -253,10 +256,7 @@ struct FitFileReaderState
 
     fit_value_t read_int32(bool is_big_endian, int *count = NULL) {
         qint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
+        memcpy(&i, read_bytes(4, count), 4);
 
         i = is_big_endian
             ? qFromBigEndian<qint32>( i )
@@ -267,10 +267,7 @@ struct FitFileReaderState
 
     fit_value_t read_uint32(bool is_big_endian, int *count = NULL) {
         quint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
+        memcpy(&i, read_bytes(4, count), 4);
 
         i = is_big_endian
             ? qFromBigEndian<quint32>( i )
@@ -281,10 +278,7 @@ struct FitFileReaderState
 
     fit_value_t read_uint32z(bool is_big_endian, int *count = NULL) {
         quint32 i;
-        if (file.read(reinterpret_cast<char*>(&i), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
+        memcpy(&i, read_bytes(4, count), 4);
 
         i = is_big_endian
             ? qFromBigEndian<quint32>( i )
@@ -295,10 +289,7 @@ struct FitFileReaderState
 
     fit_float_value read_float32(int *count = NULL) {
         float f;
-        if (file.read(reinterpret_cast<char*>(&f), 4) != 4)
-            throw TruncatedRead();
-        if (count)
-            (*count) += 4;
+        memcpy(&f, read_bytes(4, count), 4);
 
         return f;
     }
@@ -2467,11 +2458,15 @@ struct FitFileReaderState
 
             data_size = read_uint32(false); // always littleEndian
             char fit_str[5];
-            if (file.read(fit_str, 4) != 4) {
+            if (pos + 4 > size) {
                 errors << "truncated header";
                 stop = true;
+                fit_str[0] = '\0';
+                pos = size;
+            } else {
+                memcpy(fit_str, read_bytes(4), 4);
+                fit_str[4] = '\0';
             }
-            fit_str[4] = '\0';
             if (strcmp(fit_str, ".FIT") != 0) {
                 errors << QString("bad header, expected \".FIT\" but got \"%1\"").arg(fit_str);
                 stop = true;
@@ -2494,8 +2489,10 @@ struct FitFileReaderState
             int local_msg_type = header_byte & 0xf;
             bool with_deve_data = (header_byte & 0x20) == 0x20 ;
 
-            local_msg_types.insert(local_msg_type, FitDefinition());
+            // redefine in place, clearing the fields keeps their storage
             FitDefinition &def = local_msg_types[local_msg_type];
+            def.fields.clear();
+            local_msg_defined[local_msg_type] = true;
 
             int reserved = read_uint8(&count); (void) reserved; // unused
             def.is_big_endian = read_uint8(&count);
@@ -2564,7 +2561,7 @@ struct FitFileReaderState
                 local_msg_type = header_byte & 0xf;
             }
 
-            if (!local_msg_types.contains(local_msg_type)) {
+            if (!local_msg_defined[local_msg_type]) {
                 printf( "local type %d without previous definition\n", local_msg_type );
                 errors << QString("local type %1 without previous definition").arg(local_msg_type);
                 stop = true;
@@ -2577,8 +2574,11 @@ struct FitFileReaderState
                     def.global_msg_num, time_offset );
             }
 
+            // foreach would copy the std::vector on every record
             std::vector<FitValue> values;
-            foreach(const FitField &field, def.fields) {
+            values.reserve(def.fields.size());
+            for (size_t f = 0; f < def.fields.size(); ++f) {
+                const FitField &field = def.fields[f];
                 FitValue value;
                 int size;
 
@@ -2856,6 +2856,15 @@ struct FitFileReaderState
             return NULL;
         }
 
+        // map it in, or if that isn't possible read it all in one go
+        size = file.size();
+        data = reinterpret_cast<const char*>(file.map(0, size));
+        if (data == NULL) {
+            contents = file.readAll();
+            data = contents.constData();
+            size = contents.size();
+        }
+
         int data_size = 0;
         weatherXdata = new XDataSeries();
         weatherXdata->name = "WEATHER";
@@ -2940,7 +2949,7 @@ struct FitFileReaderState
 
                 // second file ?
                 try {
-                    while (file.canReadLine()) {
+                    while (more()) {
                         read_header(stop, errors, data_size);
                         if (!stop) {
 
@@ -113,7 +113,9 @@ FixElevation::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString
 
     std::vector<elevationGPSPoint> elvPoints;
 
-    ride->command->startLUW("Fix Elevation Data");
+    // the new altitudes, set in one go below
+    QVector<double> alt;
+    foreach (RideFilePoint *point, ride->dataPoints()) alt << point->alt;
 
     int lastDistance = 0;
     for (int i=0; i<ride->dataPoints().count(); i++) {
@@ -132,7 +134,7 @@ FixElevation::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString
                 //grab a gps point every 20 meters
                 lastDistance = (int) (ride->dataPoints()[i]->km * 1000) + 20;
             }
-            ride->command->setPointValue(i, RideFile::alt, 0);
+            alt[i] = 0;
         }
     }
 
@@ -168,6 +170,7 @@ FixElevation::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString
         return false;
     }
 
+    ride->command->startLUW("Fix Elevation Data");
 
     if (elevationPoints.length() > 0) {
         QVector<double> smoothArray(elevationPoints.length());
@@ -200,31 +203,27 @@ FixElevation::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString
         for( std::vector<elevationGPSPoint>::iterator point = elvPoints.begin() ; point != elvPoints.end() ; ++point ) {
             double elev = smoothArray.size() > loopCount ? smoothArray[loopCount] : -100;
             // ignore any seriously negative points
-            if (elev>-100) ride->command->setPointValue(point->rideFileIndex, RideFile::alt, elev);
+            if (elev>-100) alt[point->rideFileIndex] = elev;
             ++loopCount;
         }
 
-        // set data present if not currently so
-        if (ride->areDataPresent()->alt == false) ride->command->setDataPresent(RideFile::alt, true);
-
-
         int lastgood = -1;  // where did we last have decent GPS data?
-        for (int i=0; i<ride->dataPoints().count(); i++) {
+        for (int i=0; i<alt.count(); i++) {
             // is this one decent?
-            if (ride->dataPoints()[i]->alt != double(0)) {
+            if (alt[i] != double(0)) {
 
                 if (lastgood != -1 && (lastgood+1) != i) {
                     // interpolate from last good to here
                     // then set last good to here
-                    double deltaAlt = (ride->dataPoints()[i]->alt - ride->dataPoints()[lastgood]->alt) / double(i-lastgood);
+                    double deltaAlt = (alt[i] - alt[lastgood]) / double(i-lastgood);
                     for (int j=lastgood+1; j<i; j++) {
-                        ride->command->setPointValue(j, RideFile::alt, ride->dataPoints()[lastgood]->alt + (double(j-lastgood)*deltaAlt));
+                        alt[j] = alt[lastgood] + (double(j-lastgood)*deltaAlt);
                         errors++;
                     }
                 } else if (lastgood == -1) {
                     // fill to front
                     for (int j=0; j<i; j++) {
-                        ride->command->setPointValue(j, RideFile::alt, ride->dataPoints()[i]->alt);
+                        alt[j] = alt[i];
                         errors++;
                     }
                 }
@@ -233,17 +232,27 @@ FixElevation::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString
         }
 
         // fill to end...
-        if (lastgood != -1 && lastgood != (ride->dataPoints().count()-1)) {
+        if (lastgood != -1 && lastgood != (alt.count()-1)) {
            // fill from lastgood to end with lastgood
-            for (int j=lastgood+1; j<ride->dataPoints().count(); j++) {
-                ride->command->setPointValue(j, RideFile::alt, ride->dataPoints()[lastgood]->alt);
+            for (int j=lastgood+1; j<alt.count(); j++) {
+                alt[j] = alt[lastgood];
                 errors++;
             }
         }
 
+        ride->command->setPointValues(0, RideFile::alt, alt);
+
+        // set data present if not currently so
+        if (ride->areDataPresent()->alt == false) ride->command->setDataPresent(RideFile::alt, true);
+
         // Invalidate slope data to be recomputed based on new altitude data
         if (ride->areDataPresent()->slope == true)
             ride->command->setDataPresent(RideFile::slope, false);
+
+    } else {
+
+        // we still cleared the altitude for the gps points
+        ride->command->setPointValues(0, RideFile::alt, alt);
     }
 
     // close LUW
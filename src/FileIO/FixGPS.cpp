@@ -88,29 +88,34 @@ FixGPS::postProcess(RideFile *ride, DataProcessorConfig *config, QString op)
 
     int errors=0;
 
-    ride->command->startLUW("Fix GPS Errors");
+    // the fixed values, set in one go below
+    QVector<double> lat, lon;
+    foreach (RideFilePoint *point, ride->dataPoints()) {
+        lat << point->lat;
+        lon << point->lon;
+    }
 
     int lastgood = -1;  // where did we last have decent GPS data?
-    for (int i=0; i<ride->dataPoints().count(); i++) {
+    for (int i=0; i<lat.count(); i++) {
         // is this one decent?
-        if (ride->dataPoints()[i]->lat && ride->dataPoints()[i]->lat >= double(-90) && ride->dataPoints()[i]->lat <= double(90) &&
-            ride->dataPoints()[i]->lon && ride->dataPoints()[i]->lon >= double(-180) && ride->dataPoints()[i]->lon <= double(180)) {
+        if (lat[i] && lat[i] >= double(-90) && lat[i] <= double(90) &&
+            lon[i] && lon[i] >= double(-180) && lon[i] <= double(180)) {
 
             if (lastgood != -1 && (lastgood+1) != i) {
                 // interpolate from last good to here
                 // then set last good to here
-                double deltaLat = (ride->dataPoints()[i]->lat - ride->dataPoints()[lastgood]->lat) / double(i-lastgood);
-                double deltaLon = (ride->dataPoints()[i]->lon - ride->dataPoints()[lastgood]->lon) / double(i-lastgood);
+                double deltaLat = (lat[i] - lat[lastgood]) / double(i-lastgood);
+                double deltaLon = (lon[i] - lon[lastgood]) / double(i-lastgood);
                 for (int j=lastgood+1; j<i; j++) {
-                    ride->command->setPointValue(j, RideFile::lat, ride->dataPoints()[lastgood]->lat + (double(j-lastgood)*deltaLat));
-                    ride->command->setPointValue(j, RideFile::lon, ride->dataPoints()[lastgood]->lon + (double(j-lastgood)*deltaLon));
+                    lat[j] = lat[lastgood] + (double(j-lastgood)*deltaLat);
+                    lon[j] = lon[lastgood] + (double(j-lastgood)*deltaLon);
                     errors++;
                 }
             } else if (lastgood == -1) {
                 // fill to front
                 for (int j=0; j<i; j++) {
-                    ride->command->setPointValue(j, RideFile::lat, ride->dataPoints()[i]->lat);
-                    ride->command->setPointValue(j, RideFile::lon, ride->dataPoints()[i]->lon);
+                    lat[j] = lat[i];
+                    lon[j] = lon[i];
                     errors++;
                 }
             }
@@ -119,14 +124,18 @@ FixGPS::postProcess(RideFile *ride, DataProcessorConfig *config, QString op)
     }
 
     // fill to end...
-    if (lastgood != -1 && lastgood != (ride->dataPoints().count()-1)) {
+    if (lastgood != -1 && lastgood != (lat.count()-1)) {
        // fill from lastgood to end with lastgood
-        for (int j=lastgood+1; j<ride->dataPoints().count(); j++) {
-            ride->command->setPointValue(j, RideFile::lat, ride->dataPoints()[lastgood]->lat);
-            ride->command->setPointValue(j, RideFile::lon, ride->dataPoints()[lastgood]->lon);
+        for (int j=lastgood+1; j<lat.count(); j++) {
+            lat[j] = lat[lastgood];
+            lon[j] = lon[lastgood];
             errors++;
         }
     } 
+
+    ride->command->startLUW("Fix GPS Errors");
+    ride->command->setPointValues(0, RideFile::lat, lat);
+    ride->command->setPointValues(0, RideFile::lon, lon);
     ride->command->endLUW();
 
     if (errors) {
@@ -218,46 +218,50 @@ FixGaps::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op="
 
 
                 // add the points
+                QVector<RideFilePoint> points;
                 for(int i=0; i<count; i++) {
-                    RideFilePoint *add = new RideFilePoint(last->secs+((i+1)*ride->recIntSecs()),
-                                                           last->cad+((i+1)*caddelta),
-                                                           last->hr + ((i+1)*hrdelta),
-                                                           last->km + ((i+1)*kmdelta),
-                                                           last->kph + ((i+1)*kphdelta),
-                                                           last->nm + ((i+1)*nmdelta),
-                                                           last->watts + ((i+1)*pwrdelta),
-                                                           last->alt + ((i+1)*altdelta),
-                                                           last->lon + ((i+1)*londelta),
-                                                           last->lat + ((i+1)*latdelta),
-                                                           last->headwind + ((i+1)*hwdelta),
-                                                           last->slope + ((i+1)*slopedelta),
-                                                           last->temp + ((i+1)*temperaturedelta),
-                                                           last->lrbalance + ((i+1)*lrbalancedelta),
-                                                           last->lte + ((i+1)*ltedelta),
-                                                           last->rte + ((i+1)*rtedelta),
-                                                           last->lps + ((i+1)*lpsdelta),
-                                                           last->rps + ((i+1)*rpsdelta),
-                                                           last->lpco + ((i+1)*lpcodelta),
-                                                           last->rpco + ((i+1)*rpcodelta),
-                                                           last->lppb + ((i+1)*lppbdelta),
-                                                           last->rppb + ((i+1)*rppbdelta),
-                                                           last->lppe + ((i+1)*lppedelta),
-                                                           last->rppe + ((i+1)*rppedelta),
-                                                           last->lpppb + ((i+1)*lpppbdelta),
-                                                           last->rpppb + ((i+1)*rpppbdelta),
-                                                           last->lpppe + ((i+1)*lpppedelta),
-                                                           last->rpppe + ((i+1)*rpppedelta),
-                                                           last->smo2 + ((i+1)*smo2delta),
-                                                           last->thb + ((i+1)*thbdelta),
-                                                           last->rvert + ((i+1)*rvertdelta),
-                                                           last->rcad + ((i+1)*rcaddelta),
-                                                           last->rcontact + ((i+1)*rcontactdelta),
-                                                           last->tcore + ((i+1)*tcoredelta),
-                                                           last->interval);
-
-                    ride->command->insertPoint(position++, add);
+                    RideFilePoint add(last->secs+((i+1)*ride->recIntSecs()),
+                                      last->cad+((i+1)*caddelta),
+                                      last->hr + ((i+1)*hrdelta),
+                                      last->km + ((i+1)*kmdelta),
+                                      last->kph + ((i+1)*kphdelta),
+                                      last->nm + ((i+1)*nmdelta),
+                                      last->watts + ((i+1)*pwrdelta),
+                                      last->alt + ((i+1)*altdelta),
+                                      last->lon + ((i+1)*londelta),
+                                      last->lat + ((i+1)*latdelta),
+                                      last->headwind + ((i+1)*hwdelta),
+                                      last->slope + ((i+1)*slopedelta),
+                                      last->temp + ((i+1)*temperaturedelta),
+                                      last->lrbalance + ((i+1)*lrbalancedelta),
+                                      last->lte + ((i+1)*ltedelta),
+                                      last->rte + ((i+1)*rtedelta),
+                                      last->lps + ((i+1)*lpsdelta),
+                                      last->rps + ((i+1)*rpsdelta),
+                                      last->lpco + ((i+1)*lpcodelta),
+                                      last->rpco + ((i+1)*rpcodelta),
+                                      last->lppb + ((i+1)*lppbdelta),
+                                      last->rppb + ((i+1)*rppbdelta),
+                                      last->lppe + ((i+1)*lppedelta),
+                                      last->rppe + ((i+1)*rppedelta),
+                                      last->lpppb + ((i+1)*lpppbdelta),
+                                      last->rpppb + ((i+1)*rpppbdelta),
+                                      last->lpppe + ((i+1)*lpppedelta),
+                                      last->rpppe + ((i+1)*rpppedelta),
+                                      last->smo2 + ((i+1)*smo2delta),
+                                      last->thb + ((i+1)*thbdelta),
+                                      last->rvert + ((i+1)*rvertdelta),
+                                      last->rcad + ((i+1)*rcaddelta),
+                                      last->rcontact + ((i+1)*rcontactdelta),
+                                      last->tcore + ((i+1)*tcoredelta),
+                                      last->interval);
+                    points << add;
                 }
 
+                // all in one go
+                ride->command->insertPoints(position, points);
+                position += points.count();
+
             // stationary or greater than 30 seconds... fill with zeroes
             } else if (gap > stop) {
 
@@ -268,31 +272,36 @@ FixGaps::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op="
                 double kmdelta = (point->km - last->km) / (double) count;
 
                 // add zero value points
+                QVector<RideFilePoint> points;
                 for(int i=0; i<count; i++) {
-                    RideFilePoint *add = new RideFilePoint(last->secs+((i+1)*ride->recIntSecs()),
-                                                           0,
-                                                           0,
-                                                           last->km + ((i+1)*kmdelta),
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           last->alt,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           0,
-                                                           0.0, 0.0, 0.0, 0.0, //pedal torque / smoothness
-                                                           0.0, 0.0, // pedal platform offset
-                                                           0.0, 0.0, 0.0, 0.0, //pedal power phase
-                                                           0.0, 0.0, 0.0, 0.0, //pedal peak power phase
-                                                           0.0, 0.0, // smO2 / thb
-                                                           0.0, 0.0, 0.0, // running dynamics
-                                                           0.0,
-                                                           last->interval);
-                    ride->command->insertPoint(position++, add);
+                    RideFilePoint add(last->secs+((i+1)*ride->recIntSecs()),
+                                      0,
+                                      0,
+                                      last->km + ((i+1)*kmdelta),
+                                      0,
+                                      0,
+                                      0,
+                                      last->alt,
+                                      0,
+                                      0,
+                                      0,
+                                      0,
+                                      0,
+                                      0,
+                                      0.0, 0.0, 0.0, 0.0, //pedal torque / smoothness
+                                      0.0, 0.0, // pedal platform offset
+                                      0.0, 0.0, 0.0, 0.0, //pedal power phase
+                                      0.0, 0.0, 0.0, 0.0, //pedal peak power phase
+                                      0.0, 0.0, // smO2 / thb
+                                      0.0, 0.0, 0.0, // running dynamics
+                                      0.0,
+                                      last->interval);
+                    points << add;
                 }
+
+                // all in one go
+                ride->command->insertPoints(position, points);
+                position += points.count();
             }
         }
         last = point;
@@ -104,12 +104,19 @@ class FixPower : public DataProcessor {
     Q_DECLARE_TR_FUNCTIONS(FixPower)
 
     public:
-        FixPower() {}
+        FixPower() : percentageAdjust(0), absoluteAdjust(0) {}
         ~FixPower() {}
 
         // the processor
         bool postProcess(RideFile *, DataProcessorConfig* config, QString op);
 
+        // adjusts each sample, so runs as a stage
+        bool isStage() { return true; }
+        QList<RideFile::SeriesType> writes() { return QList<RideFile::SeriesType>() << RideFile::watts; }
+        bool startStage(RideFile *, DataProcessorConfig *config, QString op);
+        void processSample(RideFilePoint &point);
+        void endStage(RideFile *);
+
         // the config widget
         DataProcessorConfig* processorConfig(QWidget *parent) {
             return new FixPowerConfig(parent);
@@ -119,19 +126,26 @@ class FixPower : public DataProcessor {
         QString name() {
             return (tr("Adjust Power Values"));
         }
+
+    private:
+        double percentageAdjust, absoluteAdjust;
 };
 
 static bool FixPowerAdded = DataProcessorFactory::instance().registerProcessor(QString("Adjust Power Values"), new FixPower());
 
 bool
 FixPower::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op="")
+{
+    return DataProcessorFactory::runStages(ride, QList<DataProcessor*>() << this, config, op);
+}
+
+bool
+FixPower::startStage(RideFile *ride, DataProcessorConfig *config, QString op)
 {
     Q_UNUSED(op)
 
     // Lets do it then!
     QString tpRel, tpAbs;
-    double percentageAdjust = 0;
-    double absoluteAdjust = 0;
 
     if (config == NULL) { // being called automatically
         tpRel = appsettings->value(NULL, GC_DPPA, "0").toString();
@@ -151,31 +165,29 @@ FixPower::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op=
     // no adjustment required
     if ((percentageAdjust == 0) && (absoluteAdjust == 0)) return false;
 
-    // apply the change
-    ride->command->startLUW("Adjust Power");
-    for (int i=0; i<ride->dataPoints().count(); i++) {
-        RideFilePoint *point = ride->dataPoints()[i];
-        double newWatts = point->watts;
-        // only add/adjust if we have a value > 0
-        if (point->watts != 0 && percentageAdjust != 0) {
-            newWatts += (newWatts * (percentageAdjust / 100));
-        }
-        // only add/adjust if we have a value > 0
-        if (point->watts != 0 && absoluteAdjust != 0) {
-            newWatts += absoluteAdjust;
-        }
-        if (newWatts != point->watts) {
-           ride->command->setPointValue(i, RideFile::watts, newWatts);
-        }
+    return true;
+}
 
+void
+FixPower::processSample(RideFilePoint &point)
+{
+    double newWatts = point.watts;
+    // only add/adjust if we have a value > 0
+    if (point.watts != 0 && percentageAdjust != 0) {
+        newWatts += (newWatts * (percentageAdjust / 100));
     }
-    ride->command->endLUW();
+    // only add/adjust if we have a value > 0
+    if (point.watts != 0 && absoluteAdjust != 0) {
+        newWatts += absoluteAdjust;
+    }
+    point.watts = newWatts;
+}
 
+void
+FixPower::endStage(RideFile *ride)
+{
     double currentta = ride->getTag("Power Adjust", "0.0").toDouble();
     ride->setTag("Power Adjust", QString("%1").arg(currentta + percentageAdjust));
     double currenttaAbs = ride->getTag("Power Adjust fix", "0.0").toDouble();
     ride->setTag("Power Adjust fix", QString("%1").arg(currenttaAbs + absoluteAdjust));
-
-
-    return true;
 }
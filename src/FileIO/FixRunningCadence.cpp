@@ -66,6 +66,12 @@ class FixRunningCadence : public DataProcessor {
         // the processor
         bool postProcess(RideFile *, DataProcessorConfig* config, QString op);
 
+        // adjusts each sample, so runs as a stage
+        bool isStage() { return true; }
+        QList<RideFile::SeriesType> writes() { return QList<RideFile::SeriesType>() << RideFile::cad << RideFile::rcad; }
+        bool startStage(RideFile *, DataProcessorConfig *config, QString op);
+        void processSample(RideFilePoint &point);
+
         // the config widget
         DataProcessorConfig* processorConfig(QWidget *parent) {
             return new FixRunningCadenceConfig(parent);
@@ -81,6 +87,12 @@ static bool FixRunningCadenceAdded = DataProcessorFactory::instance().registerPr
 
 bool
 FixRunningCadence::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op="")
+{
+    return DataProcessorFactory::runStages(ride, QList<DataProcessor*>() << this, config, op);
+}
+
+bool
+FixRunningCadence::startStage(RideFile *ride, DataProcessorConfig *config, QString op)
 {
     Q_UNUSED(config)
     Q_UNUSED(op)
@@ -88,17 +100,14 @@ FixRunningCadence::postProcess(RideFile *ride, DataProcessorConfig *config=0, QS
     // does this ride have cadence?
     if (ride->areDataPresent()->cad == false && ride->areDataPresent()->rcad == false) return false;
 
-    ride->command->startLUW("Fix Running Cadence");
-
-    for (int i=0; i<ride->dataPoints().count(); i++) {
-        RideFilePoint *p = ride->dataPoints()[i];
-
-        if (p->cad > 0)
-            p->cad = p->cad / 2;
-        if (p->rcad > 0)
-            p->rcad = p->rcad / 2;
-    }
-    ride->command->endLUW();
-
     return true;
 }
+
+void
+FixRunningCadence::processSample(RideFilePoint &point)
+{
+    if (point.cad > 0)
+        point.cad = point.cad / 2;
+    if (point.rcad > 0)
+        point.rcad = point.rcad / 2;
+}
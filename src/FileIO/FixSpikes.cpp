@@ -174,7 +174,10 @@ FixSpikes::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op
     }
 
     LTMOutliers *outliers = new LTMOutliers(secs.data(), power.data(), power.count(), windowsize, false);
-    ride->command->startLUW("Fix Spikes in Recording");
+
+    // the fixed values, set in one go below
+    QVector<double> watts = power;
+
     for (int i=0; i<secs.count(); i++) {
 
         // is this over variance threshold?
@@ -192,11 +195,14 @@ FixSpikes::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op
         int pos = outliers->getIndexForRank(i);
         double left=0.0, right=0.0;
 
-        if (pos > 0) left = ride->dataPoints()[pos-1]->watts;
-        if (pos < (ride->dataPoints().count()-1)) right = ride->dataPoints()[pos+1]->watts;
+        if (pos > 0) left = watts[pos-1];
+        if (pos < (watts.count()-1)) right = watts[pos+1];
 
-        ride->command->setPointValue(pos, RideFile::watts, (left+right)/2.0);
+        watts[pos] = (left+right)/2.0;
     }
+
+    ride->command->startLUW("Fix Spikes in Recording");
+    ride->command->setPointValues(0, RideFile::watts, watts);
     ride->command->endLUW();
 
     delete outliers;
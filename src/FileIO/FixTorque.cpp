@@ -88,12 +88,19 @@ class FixTorque : public DataProcessor {
     Q_DECLARE_TR_FUNCTIONS(FixTorque)
 
     public:
-        FixTorque() {}
+        FixTorque() : nmAdjust(0) {}
         ~FixTorque() {}
 
         // the processor
         bool postProcess(RideFile *, DataProcessorConfig* config, QString op);
 
+        // adjusts each sample, so runs as a stage
+        bool isStage() { return true; }
+        QList<RideFile::SeriesType> writes() { return QList<RideFile::SeriesType>() << RideFile::watts << RideFile::nm; }
+        bool startStage(RideFile *, DataProcessorConfig *config, QString op);
+        void processSample(RideFilePoint &point);
+        void endStage(RideFile *);
+
         // the config widget
         DataProcessorConfig* processorConfig(QWidget *parent) {
             return new FixTorqueConfig(parent);
@@ -103,12 +110,21 @@ class FixTorque : public DataProcessor {
         QString name() {
             return (tr("Adjust Torque Values"));
         }
+
+    private:
+        double nmAdjust;
 };
 
 static bool fixTorqueAdded = DataProcessorFactory::instance().registerProcessor(QString("Adjust Torque Values"), new FixTorque());
 
 bool
 FixTorque::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op="")
+{
+    return DataProcessorFactory::runStages(ride, QList<DataProcessor*>() << this, config, op);
+}
+
+bool
+FixTorque::startStage(RideFile *ride, DataProcessorConfig *config, QString op)
 {
     Q_UNUSED(op)
 
@@ -117,7 +133,6 @@ FixTorque::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op
 
     // Lets do it then!
     QString ta;
-    double nmAdjust;
 
     if (config == NULL) { // being called automatically
         ta = appsettings->value(NULL, GC_DPTA, "0 nm").toString();
@@ -139,21 +154,22 @@ FixTorque::postProcess(RideFile *ride, DataProcessorConfig *config=0, QString op
     // no adjustment required
     if (nmAdjust == 0) return false;
 
-    // apply the change
-    ride->command->startLUW("Adjust Torque");
-    for (int i=0; i<ride->dataPoints().count(); i++) {
-        RideFilePoint *point = ride->dataPoints()[i];
+    return true;
+}
 
-      if (point->nm != 0) {
-            double newnm = point->nm + nmAdjust;
-            ride->command->setPointValue(i, RideFile::watts, point->watts * (newnm / point->nm));
-            ride->command->setPointValue(i, RideFile::nm, newnm);
-        }
+void
+FixTorque::processSample(RideFilePoint &point)
+{
+    if (point.nm != 0) {
+        double newnm = point.nm + nmAdjust;
+        point.watts = point.watts * (newnm / point.nm);
+        point.nm = newnm;
     }
-    ride->command->endLUW();
+}
 
+void
+FixTorque::endStage(RideFile *ride)
+{
     double currentta = ride->getTag("Torque Adjust", "0.0").toDouble();
     ride->setTag("Torque Adjust", QString("%1 nm").arg(currentta + nmAdjust));
-
-    return true;
 }
@@ -0,0 +1,328 @@
+/*
+ * Copyright (c) 2018 GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "MeanMaxIndex.h"
+#include "RideFileCache.h"
+#include "RideCache.h"
+#include "RideItem.h"
+#include "Context.h"
+#include "Athlete.h"
+
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QDebug>
+
+// weeks start on a monday, counted from an arbitrary monday
+static const QDate weekZero(2000, 1, 3);
+
+MeanMaxIndex::MeanMaxIndex(Context *context) : context(context), opened(false), modified(false)
+{
+}
+
+MeanMaxIndex::~MeanMaxIndex()
+{
+    QMutexLocker locker(&lock);
+    if (opened && modified) save();
+}
+
+qint32
+MeanMaxIndex::keyFor(int level, QDate date)
+{
+    switch(level) {
+    default:
+    case Week:
+        {
+            qint64 days = weekZero.daysTo(date);
+            return days < 0 ? (days - 6) / 7 : days / 7;
+        }
+    case Month: return (date.year() * 12) + date.month() - 1;
+    case Year: return date.year();
+    }
+}
+
+QDate
+MeanMaxIndex::startOf(int level, QDate date)
+{
+    switch(level) {
+    default:
+    case Week: return date.addDays(1 - date.dayOfWeek());
+    case Month: return QDate(date.year(), date.month(), 1);
+    case Year: return QDate(date.year(), 1, 1);
+    }
+}
+
+QDate
+MeanMaxIndex::endOf(int level, QDate date)
+{
+    switch(level) {
+    default:
+    case Week: return startOf(Week, date).addDays(6);
+    case Month: return startOf(Month, date).addMonths(1).addDays(-1);
+    case Year: return startOf(Year, date).addYears(1).addDays(-1);
+    }
+}
+
+quint64
+MeanMaxIndex::fingerprintFor(RideItem *item, const QString &cache)
+{
+    QFileInfo cpx(cache + QFileInfo(item->fileName).baseName() + ".cpx");
+
+    QByteArray key = item->fileName.toUtf8();
+    key.append(item->isRun ? 'R' : 'B');
+    key.append(QByteArray::number(cpx.exists() ? cpx.lastModified().toMSecsSinceEpoch() : 0));
+
+    // FNV-1a over the bytes
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    for (int i=0; i<key.size(); i++) hash = (hash ^ quint8(key.at(i))) * Q_UINT64_C(1099511628211);
+    return hash;
+}
+
+quint64
+MeanMaxIndex::combine(quint64 fingerprint, quint64 ride)
+{
+    // order sensitive, the rides are always visited in the
+    // same order, so different sets of rides don't cancel out
+    return (fingerprint ^ ride) * Q_UINT64_C(1099511628211) + Q_UINT64_C(0x9e3779b97f4a7c15);
+}
+
+void
+MeanMaxIndex::merge(QVector<float> &into, const QVector<float> &from)
+{
+    if (into.size() < from.size()) into.resize(from.size());
+
+    const float *f = from.constData();
+    float *t = into.data();
+    for (int i=0; i<from.size(); i++) if (f[i] > t[i]) t[i] = f[i];
+}
+
+void
+MeanMaxIndex::invalidate(QDate date)
+{
+    QMutexLocker locker(&lock);
+    stale.insert(date);
+}
+
+QVector<float>
+MeanMaxIndex::meanMaxPowerFor(QVector<float> &wpk, QDate from, QDate to, bool wantruns)
+{
+    QMutexLocker locker(&lock);
+
+    if (!opened) open();
+
+    // rebuild the envelopes for anything that changed since last time
+    if (!stale.isEmpty()) {
+        QSet<qint32> invalid[Levels];
+        foreach(QDate date, stale)
+            for (int level=0; level<Levels; level++)
+                invalid[level].insert(keyFor(level, date));
+        stale.clear();
+        rebuild(invalid);
+        if (modified) save();
+    }
+
+    QVector<float> watts;
+    wpk.resize(0);
+
+    // walk through the range taking the biggest envelope that fits
+    // and collect the odd days at either end to read from the cpx
+    QSet<QDate> days;
+    QDate date = from;
+    while (date <= to) {
+
+        int level;
+        for (level=Year; level>=Week; level--)
+            if (startOf(level, date) == date && endOf(level, date) <= to) break;
+
+        if (level >= Week) {
+
+            const Envelope &e = envelopes[level].value(keyFor(level, date));
+            merge(watts, e.watts[0]);
+            merge(wpk, e.wpk[0]);
+            if (wantruns) {
+                merge(watts, e.watts[1]);
+                merge(wpk, e.wpk[1]);
+            }
+            date = endOf(level, date).addDays(1);
+
+        } else {
+            days.insert(date);
+            date = date.addDays(1);
+        }
+    }
+
+    // the odd days
+    if (days.count()) {
+        QString activities = context->athlete->home->activities().canonicalPath() + "/";
+        foreach(RideItem *item, context->athlete->rideCache->rides()) {
+
+            if (!days.contains(item->dateTime.date())) continue;
+            if (item->isRun && !wantruns) continue;
+
+            QVector<float> ridewpk;
+            merge(watts, RideFileCache::meanMaxPowerFor(context, ridewpk, activities + item->fileName));
+            merge(wpk, ridewpk);
+        }
+    }
+
+    return watts;
+}
+
+void
+MeanMaxIndex::open()
+{
+    opened = true;
+
+    // read what we saved last time
+    QFile file(context->athlete->home->cache().canonicalPath() + "/meanmax.idx");
+    if (file.open(QFile::ReadOnly)) {
+
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_4_6);
+
+        quint32 version, cacheversion;
+        in >> version >> cacheversion;
+
+        if (version == MeanMaxIndexVersion && cacheversion == RideFileCacheVersion) {
+            for (int level=0; level<Levels && in.status() == QDataStream::Ok; level++) {
+                quint32 count;
+                in >> count;
+                for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+                    qint32 key;
+                    Envelope e;
+                    in >> key >> e.fingerprint >> e.watts[0] >> e.wpk[0] >> e.watts[1] >> e.wpk[1];
+                    envelopes[level].insert(key, e);
+                }
+            }
+            if (in.status() != QDataStream::Ok)
+                for (int level=0; level<Levels; level++) envelopes[level].clear();
+        }
+        file.close();
+    }
+
+    // now fingerprint what we have now, if its different the
+    // .cpx files changed whilst we weren't watching
+    QMap<qint32, quint64> fingerprints[Levels];
+    QString cache = context->athlete->home->cache().canonicalPath() + "/";
+    foreach(RideItem *item, context->athlete->rideCache->rides()) {
+
+        QDate date = item->dateTime.date();
+        quint64 fingerprint = fingerprintFor(item, cache);
+
+        for (int level=0; level<Levels; level++) {
+            qint32 key = keyFor(level, date);
+            fingerprints[level][key] = combine(fingerprints[level].value(key), fingerprint);
+        }
+    }
+
+    QSet<qint32> invalid[Levels];
+    for (int level=0; level<Levels; level++) {
+
+        // nothing in this envelope any more
+        foreach(qint32 key, envelopes[level].keys())
+            if (!fingerprints[level].contains(key)) envelopes[level].remove(key);
+
+        // missing or out of date
+        QMapIterator<qint32, quint64> it(fingerprints[level]);
+        while (it.hasNext()) {
+            it.next();
+            if (envelopes[level].value(it.key()).fingerprint != it.value()) invalid[level].insert(it.key());
+        }
+    }
+    rebuild(invalid);
+
+    // the fingerprints get set in rebuild()
+    if (modified) save();
+}
+
+void
+MeanMaxIndex::rebuild(QSet<qint32> invalid[Levels])
+{
+    bool any = false;
+    for (int level=0; level<Levels; level++) {
+        foreach(qint32 key, invalid[level]) envelopes[level].remove(key);
+        if (invalid[level].count()) any = true;
+    }
+    if (!any) return;
+
+    modified = true;
+
+    // one pass through the rides, reading the cpx for each
+    // ride once, at most, and merging into all the envelopes
+    // that need rebuilding
+    QString activities = context->athlete->home->activities().canonicalPath() + "/";
+    QString cache = context->athlete->home->cache().canonicalPath() + "/";
+    foreach(RideItem *item, context->athlete->rideCache->rides()) {
+
+        QDate date = item->dateTime.date();
+        qint32 keys[Levels];
+        bool needed = false;
+        for (int level=0; level<Levels; level++) {
+            keys[level] = keyFor(level, date);
+            if (invalid[level].contains(keys[level])) needed = true;
+        }
+        if (!needed) continue;
+
+        quint64 fingerprint = fingerprintFor(item, cache);
+
+        QVector<float> wpk;
+        QVector<float> watts = RideFileCache::meanMaxPowerFor(context, wpk, activities + item->fileName);
+
+        int run = item->isRun ? 1 : 0;
+        for (int level=0; level<Levels; level++) {
+            if (!invalid[level].contains(keys[level])) continue;
+
+            Envelope &e = envelopes[level][keys[level]];
+            e.fingerprint = combine(e.fingerprint, fingerprint);
+            merge(e.watts[run], watts);
+            merge(e.wpk[run], wpk);
+        }
+    }
+}
+
+void
+MeanMaxIndex::save()
+{
+    // write to a temporary file and then replace, so a
+    // crash mid-write doesn't leave a corrupt index
+    QString name = context->athlete->home->cache().canonicalPath() + "/meanmax.idx";
+    QFile file(name + ".tmp");
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_6);
+
+    out << MeanMaxIndexVersion << quint32(RideFileCacheVersion);
+    for (int level=0; level<Levels; level++) {
+        out << quint32(envelopes[level].count());
+        QMapIterator<qint32, Envelope> it(envelopes[level]);
+        while (it.hasNext()) {
+            it.next();
+            const Envelope &e = it.value();
+            out << it.key() << e.fingerprint << e.watts[0] << e.wpk[0] << e.watts[1] << e.wpk[1];
+        }
+    }
+    file.close();
+
+    QFile::remove(name);
+    if (out.status() != QDataStream::Ok || !file.rename(name)) {
+        file.remove();
+        return;
+    }
+    modified = false;
+}
@@ -0,0 +1,99 @@
+/*
+ * Copyright (c) 2018 GoldenCheetah Developers
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc., 51
+ * Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef _GC_MeanMaxIndex_h
+#define _GC_MeanMaxIndex_h 1
+#include "GoldenCheetah.h"
+
+#include <QDate>
+#include <QMap>
+#include <QSet>
+#include <QVector>
+#include <QMutex>
+
+class Context;
+class RideItem;
+
+// The mean max index holds the power and w/kg mean maximal curves
+// pre-aggregated by week, month and year so a date range can be
+// answered by combining a handful of envelopes rather than reading
+// the .cpx file for every ride in the range. Only the days at either
+// end of a range that don't make up a whole week are read from the
+// .cpx files.
+//
+// Each envelope has a fingerprint of the rides (and their .cpx files)
+// that went into it. It is saved to cache/meanmax.idx whenever it
+// changes and any envelopes whose fingerprint no longer matches are
+// rebuilt when it is next opened. When a ride's cache is refreshed, or a ride is
+// added or deleted, only the week, month and year containing it are
+// rebuilt.
+//
+// It is thread safe; the estimator uses it from a background thread
+// whilst rides are refreshed in the thread pool.
+
+// revision history:
+// version  date         description
+// 1        16-Oct-18    Initial - weeks, months and years
+// 2        16-Oct-18    Order sensitive fingerprints
+
+static const quint32 MeanMaxIndexVersion = 2;
+
+class MeanMaxIndex
+{
+    public:
+
+        MeanMaxIndex(Context *context);
+        ~MeanMaxIndex();
+
+        // same as RideFileCache::meanMaxPowerFor for a date range
+        QVector<float> meanMaxPowerFor(QVector<float> &wpk, QDate from, QDate to, bool wantruns);
+
+        // a ride on this date was refreshed, added or deleted
+        void invalidate(QDate date);
+
+    private:
+
+        enum { Week=0, Month=1, Year=2, Levels=3 };
+
+        struct Envelope {
+            Envelope() : fingerprint(0) {}
+            quint64 fingerprint;
+            QVector<float> watts[2], wpk[2]; // [0] is not runs, [1] is runs
+        };
+
+        static qint32 keyFor(int level, QDate date);
+        static QDate startOf(int level, QDate date);
+        static QDate endOf(int level, QDate date);
+        static void merge(QVector<float> &into, const QVector<float> &from);
+        static quint64 fingerprintFor(RideItem *item, const QString &cache);
+        static quint64 combine(quint64 fingerprint, quint64 ride);
+
+        // called with lock held
+        void open();
+        void save();
+        void rebuild(QSet<qint32> invalid[Levels]);
+
+        Context *context;
+        QMutex lock;
+        bool opened, modified;
+
+        QMap<qint32, Envelope> envelopes[Levels];
+        QSet<QDate> stale;
+};
+
+#endif // _GC_MeanMaxIndex_h
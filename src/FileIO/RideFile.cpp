@@ -32,6 +32,7 @@
 #include <QtXml/QtXml>
 #include <algorithm> // for std::lower_bound
 #include <assert.h>
+#include <QtEndian>
 #ifdef Q_CC_MSVC
 #include <float.h>
 #endif
@@ -65,7 +66,8 @@ const QChar deltaChar(0x0394);
 RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
             wstale(true), startTime_(startTime), recIntSecs_(recIntSecs),
             deviceType_("unknown"), data(NULL), wprime_(NULL), 
-            weight_(0), totalCount(0), totalTemp(0), dstale(true)
+            weight_(0), totalCount(0), totalTemp(0), dstale(true),
+            columns_(NULL), cstale(true), tstale(true)
 {
     command = new RideFileCommand(this);
 
@@ -80,7 +82,7 @@ RideFile::RideFile(const QDateTime &startTime, double recIntSecs) :
 // and we want to get special fields and ESPECIALLY "CP" and "Weight"
 RideFile::RideFile(RideFile *p) :
     wstale(true), recIntSecs_(p->recIntSecs_), deviceType_(p->deviceType_), data(NULL), wprime_(NULL), 
-    weight_(p->weight_), totalCount(0), dstale(true)
+    weight_(p->weight_), totalCount(0), dstale(true), columns_(NULL), cstale(true), tstale(true)
 {
     startTime_ = p->startTime_;
     tags_ = p->tags_;
@@ -101,7 +103,7 @@ RideFile::RideFile(RideFile *p) :
 
 RideFile::RideFile() : 
     wstale(true), recIntSecs_(0.0), deviceType_("unknown"), data(NULL), wprime_(NULL), 
-    weight_(0), totalCount(0), dstale(true)
+    weight_(0), totalCount(0), dstale(true), columns_(NULL), cstale(true), tstale(true)
 {
     command = new RideFileCommand(this);
 
@@ -122,6 +124,7 @@ RideFile::~RideFile()
         //delete interval;
     delete command;
     if (wprime_) delete wprime_;
+    if (columns_) delete columns_;
 
     // delete any Xdata
     QMapIterator<QString,XDataSeries*> it(xdata_);
@@ -138,24 +141,39 @@ void RideFile::setStartTime(const QDateTime &value) {
     startTime_ = value;
 }
 
+// used to spot when a file has been touched but not changed, it needs
+// to see every byte but not much else; qChecksum is a crc16 that goes a
+// byte at a time and we used to read the whole file into memory first,
+// so now we read in blocks and mix in 8 bytes at a time (FNV style)
 unsigned int
 RideFile::computeFileCRC(QString filename)
 {
     QFile file(filename);
-    QFileInfo fileinfo(file);
 
     // open file
     if (!file.open(QFile::ReadOnly)) return 0;
 
-    // allocate space
-    QScopedArrayPointer<char> data(new char[file.size()]);
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+    const quint64 prime = Q_UINT64_C(1099511628211);
 
-    // read entire file into memory
-    QDataStream *rawstream(new QDataStream(&file));
-    rawstream->readRawData(&data[0], file.size());
+    QScopedArrayPointer<char> data(new char[65536]);
+    qint64 len;
+    while ((len = file.read(&data[0], 65536)) > 0) {
+
+        // 8 bytes at a time, read as little endian so the
+        // crc is the same whichever machine computes it
+        const uchar *bytes = reinterpret_cast<const uchar*>(&data[0]);
+        qint64 i=0;
+        for (; i+8 <= len; i += 8) {
+            quint64 word = qFromLittleEndian<quint64>(bytes + i);
+            hash = (hash ^ word) * prime;
+        }
+        for (; i < len; i++) hash = (hash ^ static_cast<unsigned char>(data[i])) * prime;
+    }
+    hash ^= static_cast<quint64>(file.size());
     file.close();
 
-    return qChecksum(&data[0], file.size());
+    return static_cast<unsigned int>(hash ^ (hash >> 32));
 }
 
 void
@@ -1520,6 +1538,7 @@ void RideFile::appendOrUpdatePoint(double secs, double cad, double hr, double km
     dataPresent.rcontact |= (rcontact != 0);
     dataPresent.tcore    |= (tcore != 0);
     dataPresent.interval |= (interval != 0);
+    cstale = tstale = true;
 
     updateMin(point);
     updateMax(point);
@@ -1671,6 +1690,7 @@ RideFile::setDataPresent(SeriesType series, bool value)
         case none : break;
     }
     updateDataTag();
+    cstale = tstale = true;
 }
 
 bool
@@ -1773,6 +1793,7 @@ RideFile::setPointValue(int index, SeriesType series, double value)
         default:
         case none : break;
     }
+    cstale = tstale = true;
 }
 
 double
@@ -2109,6 +2130,7 @@ RideFile::deletePoint(int index)
 {
     delete dataPoints_[index];
     dataPoints_.remove(index);
+    cstale = tstale = true;
 }
 
 void
@@ -2116,12 +2138,23 @@ RideFile::deletePoints(int index, int count)
 {
     for(int i=index; i<(index+count); i++) delete dataPoints_[i];
     dataPoints_.remove(index, count);
+    cstale = tstale = true;
 }
 
 void
 RideFile::insertPoint(int index, RideFilePoint *point)
 {
     dataPoints_.insert(index, point);
+    cstale = tstale = true;
+}
+
+void
+RideFile::insertPoints(int index, QVector <struct RideFilePoint *> newRows)
+{
+    // shift the points after index just the once
+    dataPoints_.insert(index, newRows.count(), NULL);
+    for (int i=0; i<newRows.count(); i++) dataPoints_[index+i] = newRows[i];
+    cstale = tstale = true;
 }
 
 void
@@ -2142,6 +2175,7 @@ void
 RideFile::appendPoints(QVector <struct RideFilePoint *> newRows)
 {
     dataPoints_ += newRows;
+    cstale = tstale = true;
 }
 
 void
@@ -2155,7 +2189,7 @@ void
 RideFile::emitSaved()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = dstale = cstale = tstale = true;
     emit saved();
 }
 
@@ -2163,7 +2197,7 @@ void
 RideFile::emitReverted()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = dstale = cstale = tstale = true;
     emit reverted();
 }
 
@@ -2171,7 +2205,7 @@ void
 RideFile::emitModified()
 {
     weight_ = 0;
-    wstale = dstale = true;
+    wstale = dstale = cstale = tstale = true;
     emit modified();
 }
 
@@ -2809,8 +2843,9 @@ RideFile::recalculateDerivedSeries(bool force)
     avgPoint->apower = APcount ? (APtotal / APcount) : 0;
     totalPoint->apower = APtotal;
 
-    // and we're done
+    // and we're done, columns need refreshing
     dstale=false;
+    cstale=tstale=true;
 }
 
 #ifdef GC_HAVE_SAMPLERATE
@@ -3274,28 +3309,222 @@ RideFile::symbolForSeries(SeriesType series)
 }
 
 // Iterator
+const RideFileColumns *
+RideFile::columns()
+{
+    // several mean max computers may ask at the same time
+    QMutexLocker locker(&columnsLock);
+
+    if (cstale || columns_ == NULL) {
+
+        // derived series are copied too, so get them up to date first
+        recalculateDerivedSeries();
+
+        if (columns_) delete columns_;
+        columns_ = new RideFileColumns(this);
+        cstale = false;
+    }
+    return columns_;
+}
+
+void
+RideFile::invalidateColumns()
+{
+    QMutexLocker locker(&columnsLock);
+    cstale = tstale = true;
+}
+
+QVector<double>
+RideFile::transformed(SeriesType series, Transform transform, double secs)
+{
+    QMutexLocker locker(&columnsLock);
+    if (tstale) clearTransforms();
+
+    quint64 key = (quint64(series) << 40) | (quint64(transform) << 32) | quint32(secs * 1000);
+    QHash<quint64, QVector<double> >::const_iterator it = transforms_.constFind(key);
+    if (it != transforms_.constEnd()) return it.value();
+
+    QVector<double> returning;
+    if (recIntSecs_ > 0) {
+
+        switch(transform) {
+
+        case Rolling:
+        {
+            // no point doing a rolling average if the
+            // sample rate is greater than the rolling average
+            // window!!
+            int rollingwindowsize = secs / recIntSecs_;
+            if (rollingwindowsize > 1) {
+
+                QVector<double> rolling(rollingwindowsize);
+                int index = 0;
+                double sum = 0;
+
+                returning.resize(dataPoints_.count());
+                for (int i=0; i<dataPoints_.count(); i++) {
+
+                    double value = dataPoints_[i]->value(series);
+                    sum += value;
+                    sum -= rolling[index];
+
+                    rolling[index] = value;
+                    returning[i] = sum/rollingwindowsize;
+
+                    // move index on/round
+                    index = (index >= rollingwindowsize-1) ? 0 : index+1;
+                }
+            }
+        }
+        break;
+
+        case EWMA:
+        {
+            static const double EPSILON = 0.1;
+            static const double NEGLIGIBLE = 0.1;
+
+            double secsDelta = recIntSecs_;
+            double sampsPerWindow = secs / secsDelta;
+            double attenuation = sampsPerWindow / (sampsPerWindow + secsDelta);
+            double sampleWeight = secsDelta / (sampsPerWindow + secsDelta);
+
+            double lastSecs = 0.0;
+            double weighted = 0.0;
+
+            returning.reserve(dataPoints_.count());
+            foreach(const RideFilePoint *point, dataPoints_) {
+
+                // decay through gaps in recording
+                while ((weighted > NEGLIGIBLE)
+                       && (point->secs > lastSecs + secsDelta + EPSILON)) {
+                    weighted *= attenuation;
+                    lastSecs += secsDelta;
+                    returning << weighted;
+                }
+                weighted *= attenuation;
+                weighted += sampleWeight * point->value(series);
+                lastSecs = point->secs;
+                returning << weighted;
+            }
+        }
+        break;
+        }
+    }
+
+    // keep the most recent few
+    if (transformOrder_.count() >= 8) transforms_.remove(transformOrder_.takeFirst());
+    transforms_.insert(key, returning);
+    transformOrder_ << key;
+
+    return returning;
+}
+
+void
+RideFile::sum(SeriesType series, SumOf which, int first, int last, double &total, int &count)
+{
+    total = 0;
+    count = 0;
+    if (first < 0 || last < first || last >= dataPoints_.count()) return;
+
+    QMutexLocker locker(&columnsLock);
+    if (tstale) clearTransforms();
+
+    int key = (int(series) << 1) | int(which);
+    QHash<int, PrefixSums>::iterator it = sums_.find(key);
+    if (it == sums_.end()) {
+
+        PrefixSums sums;
+        sums.totals.resize(dataPoints_.count()+1);
+        sums.counts.resize(dataPoints_.count()+1);
+        sums.totals[0] = 0;
+        sums.counts[0] = 0;
+
+        // long double so taking one total from another doesn't lose
+        // much more than adding up the samples in between would
+        long double runningtotal = 0;
+        int runningcount = 0;
+        for (int i=0; i<dataPoints_.count(); i++) {
+            double value = dataPoints_[i]->value(series);
+            if (which == Positive ? value > 0 : value >= 0) {
+                runningtotal += value;
+                runningcount++;
+            }
+            sums.totals[i+1] = runningtotal;
+            sums.counts[i+1] = runningcount;
+        }
+        it = sums_.insert(key, sums);
+    }
+
+    total = static_cast<double>(it.value().totals[last+1] - it.value().totals[first]);
+    count = it.value().counts[last+1] - it.value().counts[first];
+}
+
+void
+RideFile::clearTransforms()
+{
+    transforms_.clear();
+    transformOrder_.clear();
+    sums_.clear();
+    tstale = false;
+}
+
+RideFileColumns::RideFileColumns(RideFile *ride) : count_(ride->dataPoints().count())
+{
+    // only allocate for the series that are present, secs is
+    // always needed to stream through the samples in time
+    QVector<RideFile::SeriesType> present;
+    for (int i=0; i<static_cast<int>(RideFile::none); i++) {
+        RideFile::SeriesType series = static_cast<RideFile::SeriesType>(i);
+        if (series == RideFile::secs || ride->isDataPresent(series)) {
+            columns_[i].resize(count_);
+            present << series;
+        }
+    }
+
+    // one pass over the points, filling each column
+    for (int index=0; index<count_; index++) {
+        const RideFilePoint *p = ride->dataPoints()[index];
+        foreach(RideFile::SeriesType series, present)
+            columns_[series][index] = p->value(series);
+    }
+}
+
+// same as RideFile::timeIndex() but searching the secs column
+static int
+columnTimeIndex(const double *secs, int count, double at)
+{
+    const double *i = std::lower_bound(secs, secs + count, at);
+    if (i == secs + count) return count-1;
+    return i - secs;
+}
+
 RideFileIterator::RideFileIterator(RideFile *f, Specification spec, IterationSpec mode)
-    : f(f)
+    : f(f), c(NULL), current(-1)
 {
     // index, start and stop are set to -1
     // if they are out of bounds or f is NULL
     if (f != NULL) {
 
+        // the samples are read from the columns
+        c = f->columns();
+        int count = c->count();
+        const double *secs = c->column(RideFile::secs);
+
         // ok, so lets work out the begin and end index
         double startsecs = spec.secsStart();
         if (startsecs < 0) start = 0;
-        else start = f->timeIndex(startsecs);
+        else start = count ? columnTimeIndex(secs, count, startsecs) : -1;
 
         // check!
-        if (start >= f->dataPoints().count()) start = -1;
+        if (start >= count) start = -1;
 
         // ok, so lets work out the begin and end index
         double stopsecs = spec.secsEnd();
-        if (stopsecs < 0) stop = f->dataPoints().count()-1;
-        else stop = f->timeIndex(stopsecs); // dgr was f->timeIndex(stopsecs)-1
+        if (stopsecs < 0) stop = count-1;
+        else stop = count ? columnTimeIndex(secs, count, stopsecs) : -1; // dgr was f->timeIndex(stopsecs)-1
 
         // check!
-        if (stop >= f->dataPoints().count()) stop = -1;
+        if (stop >= count) stop = -1;
 
         // ok, so now adjust for BEFORE, AFTER
         if (mode == Before) {
@@ -3308,11 +3537,11 @@ RideFileIterator::RideFileIterator(RideFile *f, Specification spec, IterationSpe
         }
 
         if (mode == After) {
-            if (stop == f->dataPoints().count()-1) {
+            if (stop == count-1) {
                 start = stop = -1;
             } else {
                 start = stop;
-                stop = f->dataPoints().count()-1;
+                stop = count-1;
             }
         }
 
@@ -3330,12 +3559,14 @@ void
 RideFileIterator::toFront()
 {
     index = start;
+    current = -1;
 }
 
 void
 RideFileIterator::toBack()
 {
     index = stop;
+    current = -1;
 }
 
 struct RideFilePoint *
@@ -3365,15 +3596,19 @@ RideFileIterator::hasPrevious() const
 struct RideFilePoint *
 RideFileIterator::next()
 {
-    if (index >= 0 && index <= stop) return f->dataPoints()[index++];
-    else return NULL;
+    if (index >= 0 && index <= stop) {
+        current = index++;
+        return f->dataPoints()[current];
+    } else return NULL;
 }
 
 struct RideFilePoint *
 RideFileIterator::previous()
 {
-    if (index >= 0 && index >= start) return f->dataPoints()[index--];
-    else return NULL;
+    if (index >= 0 && index >= start) {
+        current = index--;
+        return f->dataPoints()[current];
+    } else return NULL;
 }
 
 struct CompareXDataPointSecs {
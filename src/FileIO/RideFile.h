@@ -27,6 +27,7 @@
 #include <QMap>
 #include <QVector>
 #include <QObject>
+#include <QMutex>
 
 class RideItem;
 class RideCache;
@@ -38,6 +39,7 @@ class XDataSeries;
 class XDataPoint;
 struct RideFilePoint;
 struct RideFileDataPresent;
+class RideFileColumns;
 class RideFileInterval;
 class EditorData;      // attached to a RideFile
 class RideFileCommand; // for manipulating ride data
@@ -50,6 +52,9 @@ class Context;      // for context; cyclist, homedir
 //
 // RideFilePoint represents the data for a single sample in a RideFile.
 //
+// RideFileColumns is a read-only, column-wise (structure of arrays) copy of
+// the samples in a RideFile, one contiguous array per series present.
+//
 // RideFileReader is an abstract base class for function-objects that take a
 // filename and return a RideFile object representing the ride stored in the
 // corresponding file.
@@ -282,6 +287,32 @@ class RideFile : public QObject // QObject to emit signals
 
         const QVector<RideFilePoint*> &dataPoints() const { return dataPoints_; }
 
+        // column-wise copy of the samples, built on demand and thrown
+        // away whenever the data is modified. It is safe to call from
+        // multiple threads, but the pointer returned is only valid
+        // until the ride is next changed -- so don't hang on to it
+        const RideFileColumns *columns();
+
+        // code that writes to the points directly, rather than through the
+        // methods above or a RideFileCommand, must call this afterwards
+        void invalidateColumns();
+
+        // a series over the whole ride transformed to the rolling average
+        // over secs used by IsoPower, or the exponentially weighted average
+        // used by xPower (including the decay through any gaps in recording)
+        // kept until the ride is changed so it is only worked out once and
+        // shared read only, no more than a handful are kept at a time
+        enum Transform { Rolling=0, EWMA=1 };
+        QVector<double> transformed(SeriesType series, Transform transform, double secs);
+
+        // total and count of the samples from first to last (inclusive, as
+        // RideFileIterator::firstIndex() and lastIndex()) that are >= 0 or
+        // > 0; from prefix sums that are built the first time a series is
+        // asked for and kept with the transforms, so each interval's
+        // averages are worked out without going through its samples
+        enum SumOf { NonNegative=0, Positive=1 };
+        void sum(SeriesType series, SumOf which, int first, int last, double &total, int &count);
+
         // recalculate all the derived data series
         // might want to move to a factory for these
         // at some point, but for now hard coded
@@ -380,6 +411,7 @@ class RideFile : public QObject // QObject to emit signals
         void deletePoint(int index);
         void deletePoints(int index, int count);
         void insertPoint(int index, RideFilePoint *point);
+        void insertPoints(int index, QVector <struct RideFilePoint *> newRows);
         void appendPoints(QVector <struct RideFilePoint *> newRows);
         void setDataPresent(SeriesType, bool);
         void insertXDataPoint(QString xdata, int index, XDataPoint *point);
@@ -439,6 +471,22 @@ class RideFile : public QObject // QObject to emit signals
 
         bool dstale; // is derived data up to date?
 
+        // column store, see columns() above
+        RideFileColumns *columns_;
+        QMutex columnsLock;
+        bool cstale; // are the columns up to date?
+
+        // transformed series, see transformed() above, also use columnsLock
+        QHash<quint64, QVector<double> > transforms_;
+        QList<quint64> transformOrder_;
+        struct PrefixSums {
+            QVector<long double> totals; // [i] is the total of samples before i
+            QVector<int> counts;
+        };
+        QHash<int, PrefixSums> sums_;
+        void clearTransforms(); // called with columnsLock held
+        bool tstale;
+
         // data required to compute headwind based on weather broadcast
         double windSpeed_, windHeading_;
 };
@@ -517,6 +565,38 @@ struct RideFilePoint
     void setValue(RideFile::SeriesType series, double value);
 };
 
+class RideFileColumns
+{
+    public:
+
+        // copy the samples from the ride, derived series must
+        // be up to date -- RideFile::columns() takes care of that
+        RideFileColumns(RideFile *ride);
+
+        // number of samples in every column
+        int count() const { return count_; }
+
+        // is there a column for this series ?
+        bool isPresent(RideFile::SeriesType series) const {
+            return series >= 0 && series < RideFile::none && columns_[series].count() == count_;
+        }
+
+        // the contiguous array of values for series, or NULL
+        // when it is not present (secs is always present)
+        const double *column(RideFile::SeriesType series) const {
+            return isPresent(series) && count_ ? columns_[series].constData() : NULL;
+        }
+
+        // value for a sample, returns 0 when the series isn't present
+        double value(int index, RideFile::SeriesType series) const {
+            return isPresent(series) ? columns_[series][index] : 0;
+        }
+
+    private:
+        int count_;
+        QVector<double> columns_[RideFile::none];
+};
+
 class RideFileIterator {
 
     public:
@@ -540,9 +620,16 @@ class RideFileIterator {
         struct RideFilePoint *next();
         struct RideFilePoint *previous();
 
+        // value from the columns for the sample last returned
+        // by next() or previous(), 0 if the series isn't present
+        double value(RideFile::SeriesType series) const {
+            return current >= 0 ? c->value(current, series) : 0;
+        }
+
     private:
         RideFile *f;
-        int start, stop, index;
+        const RideFileColumns *c;
+        int start, stop, index, current;
 };
 
 #define XDATA_MAXVALUES 32
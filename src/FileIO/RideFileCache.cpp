@@ -17,6 +17,7 @@
  */
 
 #include "RideFileCache.h"
+#include "TaskPool.h"
 #include "MainWindow.h"
 #include "Context.h"
 #include "Athlete.h"
@@ -26,6 +27,7 @@
 #include "PaceZones.h"
 #include "WPrime.h" // for wbal zones
 #include "LTMSettings.h" // getAllBestsFor needs this
+#include "MeanMaxIndex.h"
 
 #include <cmath> // for pow()
 #include <QDebug>
@@ -33,6 +35,17 @@
 #include <QMessageBox>
 #include <QtAlgorithms> // for qStableSort
 
+// vector kernels for the mean max search, AVX2 when the compiler
+// targets it (e.g. -mavx2 or /arch:AVX2) otherwise SSE2 which all
+// x86-64 processors have
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define GC_MEANMAX_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GC_MEANMAX_SSE2
+#endif
+
 static const int maxcache = 25; // lets max out at 25 caches
 
 // cache from ride
@@ -305,6 +318,10 @@ static long countForMeanMax(RideFileCacheHeader head, RideFile::SeriesType serie
 
 QVector<float> RideFileCache::meanMaxPowerFor(Context *context, QVector<float> &wpk, QDate from, QDate to, bool wantruns)
 {
+    // the index has them aggregated by week, month and year
+    if (context->athlete->meanMaxIndex)
+        return context->athlete->meanMaxIndex->meanMaxPowerFor(wpk, from, to, wantruns);
+
     QVector<float> returning;
     QVector<float> returningwpk;
     bool first = true;
@@ -855,6 +872,7 @@ RideFileCache::refreshCache()
         // invalidate any incore cache of aggregate
         // that contains this ride in its date range
         QDate date = ride->startTime().date();
+        if (context->athlete->meanMaxIndex) context->athlete->meanMaxIndex->invalidate(date);
         for (int i=0; i<context->athlete->cpxCache.count();) {
             if (date >= context->athlete->cpxCache.at(i)->start &&
                 date <= context->athlete->cpxCache.at(i)->end) {
@@ -905,25 +923,32 @@ void RideFileCache::RideFileCache::compute()
         return;
     }
 
-    // all the mean maxes
-    MeanMaxComputer thread1(ride, wattsMeanMax, RideFile::watts); thread1.start();
-    MeanMaxComputer thread2(ride, hrMeanMax, RideFile::hr); thread2.start();
-    MeanMaxComputer thread3(ride, cadMeanMax, RideFile::cad); thread3.start();
-    MeanMaxComputer thread4(ride, nmMeanMax, RideFile::nm); thread4.start();
-    MeanMaxComputer thread5(ride, kphMeanMax, RideFile::kph); thread5.start();
-    MeanMaxComputer thread6(ride, xPowerMeanMax, RideFile::xPower); thread6.start();
-    MeanMaxComputer thread7(ride, npMeanMax, RideFile::IsoPower); thread7.start();
-    MeanMaxComputer thread8(ride, vamMeanMax, RideFile::vam); thread8.start();
-    MeanMaxComputer thread9(ride, wattsKgMeanMax, RideFile::wattsKg); thread9.start();
-    MeanMaxComputer thread10(ride, aPowerMeanMax, RideFile::aPower); thread10.start();
-    MeanMaxComputer thread11(ride, kphdMeanMax, RideFile::kphd); thread11.start();
-    MeanMaxComputer thread12(ride, wattsdMeanMax, RideFile::wattsd); thread12.start();
-    MeanMaxComputer thread13(ride, caddMeanMax, RideFile::cadd); thread13.start();
-    MeanMaxComputer thread14(ride, nmdMeanMax, RideFile::nmd); thread14.start();
-    MeanMaxComputer thread15(ride, hrdMeanMax, RideFile::hrd); thread15.start();
-    MeanMaxComputer thread16(ride, aPowerKgMeanMax, RideFile::aPowerKg); thread16.start();
-
-    // all the different distributions
+    // build the column store up front, rather than have
+    // all the mean max computers queue up to build it
+    ride->columns();
+
+    // all the mean maxes, as tasks in the shared pool
+    // rather than a thread for each one
+    TaskGroup meanmaxes;
+    meanmaxes.submit(new MeanMaxComputer(ride, wattsMeanMax, RideFile::watts));
+    meanmaxes.submit(new MeanMaxComputer(ride, hrMeanMax, RideFile::hr));
+    meanmaxes.submit(new MeanMaxComputer(ride, cadMeanMax, RideFile::cad));
+    meanmaxes.submit(new MeanMaxComputer(ride, nmMeanMax, RideFile::nm));
+    meanmaxes.submit(new MeanMaxComputer(ride, kphMeanMax, RideFile::kph));
+    meanmaxes.submit(new MeanMaxComputer(ride, xPowerMeanMax, RideFile::xPower));
+    meanmaxes.submit(new MeanMaxComputer(ride, npMeanMax, RideFile::IsoPower));
+    meanmaxes.submit(new MeanMaxComputer(ride, vamMeanMax, RideFile::vam));
+    meanmaxes.submit(new MeanMaxComputer(ride, wattsKgMeanMax, RideFile::wattsKg));
+    meanmaxes.submit(new MeanMaxComputer(ride, aPowerMeanMax, RideFile::aPower));
+    meanmaxes.submit(new MeanMaxComputer(ride, kphdMeanMax, RideFile::kphd));
+    meanmaxes.submit(new MeanMaxComputer(ride, wattsdMeanMax, RideFile::wattsd));
+    meanmaxes.submit(new MeanMaxComputer(ride, caddMeanMax, RideFile::cadd));
+    meanmaxes.submit(new MeanMaxComputer(ride, nmdMeanMax, RideFile::nmd));
+    meanmaxes.submit(new MeanMaxComputer(ride, hrdMeanMax, RideFile::hrd));
+    meanmaxes.submit(new MeanMaxComputer(ride, aPowerKgMeanMax, RideFile::aPowerKg));
+
+    // all the different distributions, these share the zone
+    // settings (CP, LTHR etc) so are computed here in turn
     computeDistribution(wattsDistribution, RideFile::watts);
     computeDistribution(hrDistribution, RideFile::hr);
     computeDistribution(cadDistribution, RideFile::cad);
@@ -935,23 +960,9 @@ void RideFileCache::RideFileCache::compute()
     computeDistribution(smo2Distribution, RideFile::smo2);
     computeDistribution(wbalDistribution, RideFile::wbal);
 
-    // wait for them threads
-    thread1.wait();
-    thread2.wait();
-    thread3.wait();
-    thread4.wait();
-    thread5.wait();
-    thread6.wait();
-    thread7.wait();
-    thread8.wait();
-    thread9.wait();
-    thread10.wait();
-    thread11.wait();
-    thread12.wait();
-    thread13.wait();
-    thread14.wait();
-    thread15.wait();
-    thread16.wait();
+    // wait for the mean maxes, running any that
+    // haven't been picked up yet ourselves
+    meanmaxes.wait();
 
     // setup the doubles the users use
     doubleArray(wattsMeanMaxDouble, wattsMeanMax, RideFile::watts);
@@ -1123,85 +1134,139 @@ integrate_series(cpintdata &data)
     return integrated;
 }
 
-static data_t
-partial_max_mean(data_t *dataseries_i, int start, int end, int length, int *offset)
-{
-    int i=0;
-    data_t candidate=0;
-
-    int best_i=0;
-
-    for (i=start; i<(1+end-length); i++) {
-        data_t test_energy=dataseries_i[length+i]-dataseries_i[i];
-        if (test_energy>candidate) {
-            candidate=test_energy;
-            best_i=i;
-        }
-    }
-    if (offset) *offset=best_i;
-
-    return candidate;
-}
+/*
+   The search above is used for every duration up to the length of the
+   ride, rather than a selection of durations with the gaps filled in
+   afterwards, so the bests for long durations are exact too.
 
+   To keep that cheap;
 
-static data_t
-divided_max_mean(data_t *dataseries_i, int datalength, int length, int *offset)
-{
-    int shift=length;
+     - the offset that was best for the previous duration seeds the
+       candidate, it is usually close, so most sections are skipped
 
-    //if sorting data the following is an important speedup hack
-    if (shift>180) shift=180;
+     - sections are scanned with SSE2 or AVX2 when available; the
+       differences are the same whether computed in a vector or not
+       so the results are identical to the scalar code
 
-    int window_length=length+shift;
+     - a section's energy is only a bound when there are no negative
+       values in the series (e.g. the delta series), if there are then
+       every section is scanned.
+*/
 
-    if (window_length>datalength) window_length=datalength;
+#define MEANMAX_SECTION 180
 
-    // put down as many windows as will fit without overrunning data
-    int start=0;
-    int end=0;
-    data_t energy=0;
+// largest b[j]-a[j] for j in 0..count-1
+static inline data_t
+max_difference(const data_t *a, const data_t *b, int count)
+{
+    data_t best = b[0] - a[0];
+    int j = 0;
+
+    // four accumulators so we aren't waiting on the latency of max
+#if defined(GC_MEANMAX_AVX2)
+    if (count >= 16) {
+        __m256d m0 = _mm256_sub_pd(_mm256_loadu_pd(b), _mm256_loadu_pd(a));
+        __m256d m1 = _mm256_sub_pd(_mm256_loadu_pd(b+4), _mm256_loadu_pd(a+4));
+        __m256d m2 = _mm256_sub_pd(_mm256_loadu_pd(b+8), _mm256_loadu_pd(a+8));
+        __m256d m3 = _mm256_sub_pd(_mm256_loadu_pd(b+12), _mm256_loadu_pd(a+12));
+        for (j=16; j+16 <= count; j+=16) {
+            m0 = _mm256_max_pd(m0, _mm256_sub_pd(_mm256_loadu_pd(b+j), _mm256_loadu_pd(a+j)));
+            m1 = _mm256_max_pd(m1, _mm256_sub_pd(_mm256_loadu_pd(b+j+4), _mm256_loadu_pd(a+j+4)));
+            m2 = _mm256_max_pd(m2, _mm256_sub_pd(_mm256_loadu_pd(b+j+8), _mm256_loadu_pd(a+j+8)));
+            m3 = _mm256_max_pd(m3, _mm256_sub_pd(_mm256_loadu_pd(b+j+12), _mm256_loadu_pd(a+j+12)));
+        }
 
-    data_t candidate=0;
-    int this_offset=0;
+        double lanes[4];
+        _mm256_storeu_pd(lanes, _mm256_max_pd(_mm256_max_pd(m0, m1), _mm256_max_pd(m2, m3)));
+        for (int k=0; k<4; k++) if (lanes[k] > best) best = lanes[k];
+    }
+#elif defined(GC_MEANMAX_SSE2)
+    if (count >= 8) {
+        __m128d m0 = _mm_sub_pd(_mm_loadu_pd(b), _mm_loadu_pd(a));
+        __m128d m1 = _mm_sub_pd(_mm_loadu_pd(b+2), _mm_loadu_pd(a+2));
+        __m128d m2 = _mm_sub_pd(_mm_loadu_pd(b+4), _mm_loadu_pd(a+4));
+        __m128d m3 = _mm_sub_pd(_mm_loadu_pd(b+6), _mm_loadu_pd(a+6));
+        for (j=8; j+8 <= count; j+=8) {
+            m0 = _mm_max_pd(m0, _mm_sub_pd(_mm_loadu_pd(b+j), _mm_loadu_pd(a+j)));
+            m1 = _mm_max_pd(m1, _mm_sub_pd(_mm_loadu_pd(b+j+2), _mm_loadu_pd(a+j+2)));
+            m2 = _mm_max_pd(m2, _mm_sub_pd(_mm_loadu_pd(b+j+4), _mm_loadu_pd(a+j+4)));
+            m3 = _mm_max_pd(m3, _mm_sub_pd(_mm_loadu_pd(b+j+6), _mm_loadu_pd(a+j+6)));
+        }
 
-    for (start=0; start+window_length<=datalength; start+=shift) {
-        end=start+window_length;
-        energy=dataseries_i[end]-dataseries_i[start];
+        double lanes[2];
+        _mm_storeu_pd(lanes, _mm_max_pd(_mm_max_pd(m0, m1), _mm_max_pd(m2, m3)));
+        for (int k=0; k<2; k++) if (lanes[k] > best) best = lanes[k];
+    }
+#endif
 
-        if (energy < candidate) {
-          continue;
-        }
-        data_t window_mm=partial_max_mean(dataseries_i, start, end, length, &this_offset);
+    for (; j<count; j++) if (b[j] - a[j] > best) best = b[j] - a[j];
+    return best;
+}
 
-        if (window_mm>candidate) {
-            candidate=window_mm;
-            if (offset) *offset=this_offset;
+// the best energy for length samples, and the first offset it occurs at,
+// dataseries_i are the datalength+1 prefix sums, hint is the offset of
+// the best for a nearby length, prune is false if any values are negative
+static data_t
+exact_max_mean(const data_t *dataseries_i, int datalength, int length, int hint, bool prune, int *offset)
+{
+    const int last = datalength - length; // last offset
+    data_t candidate = 0;
+    int best = -1;
+
+    // start with where a nearby duration was best
+    if (hint >= 0 && hint <= last) {
+        data_t energy = dataseries_i[hint+length] - dataseries_i[hint];
+        if (energy > candidate) {
+            candidate = energy;
+            best = hint;
         }
     }
 
-    // if the overlapping windows don't extend to the end of the data,
-    // let's tack another one on at the end
+    for (int start=0; start <= last; start += MEANMAX_SECTION) {
 
-    if (end<datalength) {
-        start=datalength-window_length;
-        end=datalength;
-        energy=dataseries_i[end]-dataseries_i[start];
+        int count = qMin(MEANMAX_SECTION, last - start + 1);
 
-        if (energy >= candidate) {
+        // skip the section if it can't beat, or equal at an earlier
+        // offset, what we have; the energy of the section is a bound
+        // on the energy of any part of it
+        if (prune) {
+            data_t energy = dataseries_i[start+count-1+length] - dataseries_i[start];
+            if (energy < candidate || (energy == candidate && best < start)) continue;
+        }
 
-            data_t window_mm=partial_max_mean(dataseries_i, start, end, length, &this_offset);
+        data_t max = max_difference(dataseries_i + start, dataseries_i + start + length, count);
+        if (max > candidate || (max == candidate && best > start)) {
+
+            // where is it, first one wins; bounded by the section since
+            // without SSE2 max may have been computed at a higher precision
+            // than the difference we compare it with, if so take the first
+            // of the largest differences as they are stored
+            int j=0;
+            while (j < count && dataseries_i[start+j+length] - dataseries_i[start+j] != max) j++;
+            if (j == count) {
+                j = 0;
+                data_t found = dataseries_i[start+length] - dataseries_i[start];
+                for (int k=1; k<count; k++) {
+                    data_t energy = dataseries_i[start+k+length] - dataseries_i[start+k];
+                    if (energy > found) {
+                        found = energy;
+                        j = k;
+                    }
+                }
+                max = found;
+            }
 
-            if (window_mm>candidate) {
-                candidate=window_mm;
-                if (offset) *offset=this_offset;
+            if (max > candidate || start+j < best) {
+                candidate = max;
+                best = start+j;
             }
         }
     }
 
+    if (offset) *offset = best < 0 ? 0 : best;
     return candidate;
 }
 
-
 void
 MeanMaxComputer::run()
 {
@@ -1247,18 +1312,21 @@ MeanMaxComputer::run()
     cpintdata data;
     data.rec_int_ms = (int) round(ride->recIntSecs() * 1000.0);
     double lastsecs = 0;
-    bool first = true;
     double offset = 0;
-    foreach (const RideFilePoint *p, ride->dataPoints()) {
 
-        // get offset to apply on all samples if first sample
-        if (first == true) {
-            offset = p->secs;
-            first = false;
-        }
+    // stream through the column store rather than the points
+    const RideFileColumns *columns = ride->columns();
+    const double *secsColumn = columns->column(RideFile::secs);
+    const double *valueColumn = columns->column(baseSeries);
+    if (secsColumn == NULL || valueColumn == NULL) return;
+
+    // get offset to apply on all samples
+    offset = secsColumn[0];
+
+    for (int index=0; index < columns->count(); index++) {
 
         // drag back to start at 1s or whatever recIntSecs() is !
-        double psecs = p->secs - offset + ride->recIntSecs();
+        double psecs = secsColumn[index] - offset + ride->recIntSecs();
 
         // fill in any gaps in recording - use same dodgy rounding as before
         int count = (psecs - lastsecs - ride->recIntSecs()) / ride->recIntSecs();
@@ -1271,7 +1339,7 @@ MeanMaxComputer::run()
         lastsecs = psecs;
 
         double secs = round(psecs * 1000.0) / 1000;
-        if (secs > 0) data.points.append(cpintpoint(secs, (int) round(p->value(baseSeries)*double(decimals))));
+        if (secs > 0) data.points.append(cpintpoint(secs, (int) round(valueColumn[index]*double(decimals))));
     }
 
 
@@ -1391,13 +1459,23 @@ MeanMaxComputer::run()
 
     data_t *dataseries_i = integrate_series(data);
 
-    for (int i=1; i<data.points.size();) {
+    bool negatives = false;
+    for (int i=0; i<data.points.size() && !negatives; i++) if (data.points[i].value < 0) negatives = true;
 
-        int offset;
-        data_t c=divided_max_mean(dataseries_i,data.points.size(),i,&offset);
+    // only care about first 3 minutes MAX for delta series
+    bool delta = (series == RideFile::kphd  || series == RideFile::wattsd || series == RideFile::cadd ||
+                  series == RideFile::nmd  || series == RideFile::hrd);
+
+    // every duration, the best offset for one is a good start for the next
+    int offset = 0;
+    for (int i=1; i<=data.points.size(); i++) {
 
-        // snaffle it away
         int sec = i*ride->recIntSecs();
+        if (delta && sec > 180) break;
+
+        data_t c=exact_max_mean(dataseries_i, data.points.size(), i, offset, !negatives, &offset);
+
+        // snaffle it away
         data_t val = c / (data_t)i;
 
         if (sec < ride_bests.size()) {
@@ -1406,26 +1484,15 @@ MeanMaxComputer::run()
             else
                 ride_bests[sec] = val;
         }
-
-
-        // increments to limit search scope
-        if (i<120) i++;
-        else if (i<600) i+= 2;
-        else if (i<1200) i += 5;
-        else if (i<3600) i += 20;
-        else if (i<7200) i += 120;
-        else i += 300;
     }
     free(dataseries_i);
 
     //
     // FILL IN THE GAPS AND FILL TARGET ARRAY
     //
-    // We want to present a full set of bests for
-    // every duration so the data interface for this
-    // cache can remain the same, but the level of
-    // accuracy/granularity can change in here in the
-    // future if some fancy new algorithm arrives
+    // Every duration is computed, but when the recording
+    // interval is more than a second there are durations
+    // in between that we take from the next longest
     //
 
     // XXX seems we can end up with 0 at the end ?
@@ -1436,8 +1503,7 @@ MeanMaxComputer::run()
     double last = 0;
 
     // only care about first 3 minutes MAX for delta series
-    if ((series == RideFile::kphd  || series == RideFile::wattsd || series == RideFile::cadd ||
-        series == RideFile::nmd  || series == RideFile::hrd) && ride_bests.count() > 180) {
+    if (delta && ride_bests.count() > 180) {
         ride_bests.resize(180);
         array.resize(180);
     } else {
@@ -1483,11 +1549,14 @@ void RideFileCache::fastSearch(QVector<int>&input, QVector<int>&ride_bests, QVec
     }
     dataseries_i[j]=acc;
 
-    // run the algorithm
-    for (int i=1; i<input.count();) {
+    bool negatives = false;
+    for (int i=0; i<input.count() && !negatives; i++) if (input[i] < 0) negatives = true;
 
-        int offset;
-        data_t c=divided_max_mean(dataseries_i,input.count(),i,&offset);
+    // run the algorithm, for every duration
+    int offset = 0;
+    for (int i=1; i<=input.count(); i++) {
+
+        data_t c=exact_max_mean(dataseries_i, input.count(), i, offset, !negatives, &offset);
 
         // snaffle it away
         data_t val = c / (data_t)i;
@@ -1495,26 +1564,11 @@ void RideFileCache::fastSearch(QVector<int>&input, QVector<int>&ride_bests, QVec
         // save away
         ride_bests[i] = val;
         ride_offsets[i] = offset;
-
-        // increments to limit search scope
-        if (i<120) i++;
-        else if (i<600) i+= 2;
-        else if (i<1200) i += 5;
-        else if (i<3600) i += 20;
-        else if (i<7200) i += 120;
-        else i += 300;
     }
 #ifdef Q_CC_MSVC
     delete[] dataseries_i;
 #endif
 
-    // since we minimise the search space over
-    // longer durations we need to fill in the gaps
-    int last=0;
-    for (int i=ride_bests.size()-1; i; i--) {
-        if (ride_bests[i] == 0) ride_bests[i]=last;
-        else last = ride_bests[i];
-    }
 }
 
 void
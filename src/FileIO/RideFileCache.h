@@ -23,6 +23,7 @@
 #include <QDataStream>
 #include <QVector>
 #include <QThread>
+#include <QRunnable>
 
 class Context;
 class RideFile;
@@ -41,7 +42,7 @@ typedef double data_t;
 // arrays when plotting CP curves and histograms. It is precoputed
 // to save time and cached in a file .cpx
 //
-static const unsigned int RideFileCacheVersion = 25;
+static const unsigned int RideFileCacheVersion = 26;
 // revision history:
 // version  date         description
 // 1        29-Apr-11    Initial - header, mean-max & distribution data blocks
@@ -68,6 +69,7 @@ static const unsigned int RideFileCacheVersion = 25;
 // 23       14-Jun-15    Added W'bal TiZ and Distribution
 // 24       15-Jun-15    Fix percentify error on W'bal Distribution
 // 25       19-Dec-16    Added aPower
+// 26       16-Oct-18    Exact mean maximals for long durations
 
 // The cache file (.cpx) has a binary format:
 // 1 x Header data - describing the version and contents of the cache
@@ -404,8 +406,8 @@ struct cpintdata {
     cpintdata() : rec_int_ms(0) {}
 };
 
-// the mean-max computer ... runs in a thread
-class MeanMaxComputer : public QThread
+// the mean-max computer ... runs as a task in a TaskGroup
+class MeanMaxComputer : public QRunnable
 {
     public:
         MeanMaxComputer(RideFile *ride, QVector<float>&array, RideFile::SeriesType series)
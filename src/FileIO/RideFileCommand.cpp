@@ -50,6 +50,24 @@ RideFileCommand::setPointValue(int index, RideFile::SeriesType series, double va
     doCommand(cmd);
 }
 
+void
+RideFileCommand::setPointValues(int index, RideFile::SeriesType series, QVector<double> values)
+{
+    // we only keep the values that changed, from the
+    // first to the last, to keep the undo history small
+    int from = 0, to = values.count()-1;
+    while (from <= to && doubles_equal(ride->getPointValue(index+from, series), values[from])) from++;
+    while (to >= from && doubles_equal(ride->getPointValue(index+to, series), values[to])) to--;
+    if (from > to) return; // nothing changed
+
+    QVector<double> current(to-from+1);
+    for(int i=from; i<=to; i++) current[i-from] = ride->getPointValue(index+i, series);
+
+    SetPointValuesCommand *cmd = new SetPointValuesCommand(ride, index+from, series,
+                                    current, values.mid(from, to-from+1));
+    doCommand(cmd);
+}
+
 void
 RideFileCommand::deletePoint(int index)
 {
@@ -89,6 +107,15 @@ RideFileCommand::insertPoint(int index, RideFilePoint *points)
     doCommand(cmd);
 }
 
+void
+RideFileCommand::insertPoints(int index, QVector <RideFilePoint> points)
+{
+    if (points.count() == 0) return;
+
+    InsertPointsCommand *cmd = new InsertPointsCommand(ride, index, points);
+    doCommand(cmd);
+}
+
 void
 RideFileCommand::insertXDataPoint(QString xdata, int index, XDataPoint *points)
 {
@@ -363,6 +390,34 @@ SetPointValueCommand::undoCommand()
     return true;
 }
 
+// Set a range of values in a series
+SetPointValuesCommand::SetPointValuesCommand(RideFile *ride, int row,
+            RideFile::SeriesType series, QVector<double> oldvalues, QVector<double> newvalues) :
+            RideCommand(ride), // base class looks after these
+            row(row), count(newvalues.count()), series(series), oldvalues(oldvalues), newvalues(newvalues)
+{
+    type = RideCommand::SetPointValues;
+    description = tr("Set Values");
+}
+
+bool
+SetPointValuesCommand::doCommand()
+{
+    for (int i=0; i<count; i++)
+        if (!doubles_equal(oldvalues[i], newvalues[i]))
+            ride->setPointValue(row+i, series, newvalues[i]);
+    return true;
+}
+
+bool
+SetPointValuesCommand::undoCommand()
+{
+    for (int i=0; i<count; i++)
+        if (!doubles_equal(oldvalues[i], newvalues[i]))
+            ride->setPointValue(row+i, series, oldvalues[i]);
+    return true;
+}
+
 // Remove a point
 DeletePointCommand::DeletePointCommand(RideFile *ride, int row, RideFilePoint point) :
         RideCommand(ride), // base class looks after these
@@ -406,7 +461,9 @@ DeletePointsCommand::doCommand()
 bool
 DeletePointsCommand::undoCommand()
 {
-    for (int i=(count-1); i>=0; i--) ride->insertPoint(row, new RideFilePoint(points[i]));
+    QVector<RideFilePoint *> newPoints;
+    foreach (RideFilePoint point, points) newPoints.append(new RideFilePoint(point));
+    ride->insertPoints(row, newPoints);
     return true;
 }
 
@@ -433,6 +490,31 @@ InsertPointCommand::undoCommand()
     return true;
 }
 
+// Insert points
+InsertPointsCommand::InsertPointsCommand(RideFile *ride, int row, QVector<RideFilePoint> points) :
+        RideCommand(ride), // base class looks after these
+        row(row), count(points.count()), points(points)
+{
+    type = RideCommand::InsertPoints;
+    description = tr("Insert Points");
+}
+
+bool
+InsertPointsCommand::doCommand()
+{
+    QVector<RideFilePoint *> newPoints;
+    foreach (RideFilePoint point, points) newPoints.append(new RideFilePoint(point));
+    ride->insertPoints(row, newPoints);
+    return true;
+}
+
+bool
+InsertPointsCommand::undoCommand()
+{
+    ride->deletePoints(row, count);
+    return true;
+}
+
 // Append points
 AppendPointsCommand::AppendPointsCommand(RideFile *ride, int row, QVector<RideFilePoint> points) :
         RideCommand(ride), // base class looks after these
@@ -457,7 +539,7 @@ AppendPointsCommand::doCommand()
 bool
 AppendPointsCommand::undoCommand()
 {
-    for (int i=0; i<count; i++) ride->deletePoint(row);
+    ride->deletePoints(row, count);
     return true;
 }
 
@@ -52,6 +52,11 @@ class RideFileCommand : public QObject
         void deletePoint(int index);
         void deletePoints(int index, int count);
         void insertPoint(int index, RideFilePoint *point);
+
+        // bulk changes are recorded as a single command, so use
+        // these rather than calling the above for every sample
+        void setPointValues(int index, RideFile::SeriesType series, QVector<double> values);
+        void insertPoints(int index, QVector <struct RideFilePoint> points);
         void appendPoints(QVector <struct RideFilePoint> newRows);
         void setDataPresent(RideFile::SeriesType, bool);
 
@@ -106,7 +111,8 @@ class RideCommand
         // supported command types
         enum commandtype { NoOp, LUW, SetPointValue, DeletePoint, DeletePoints, InsertPoint, AppendPoints, SetDataPresent,
                            removeXData, addXData, RemoveXDataSeries, AddXDataSeries,
-                           SetXDataPointValue, DeleteXDataPoints, InsertXDataPoint, AppendXDataPoints };
+                           SetXDataPointValue, DeleteXDataPoints, InsertXDataPoint, AppendXDataPoints,
+                           SetPointValues, InsertPoints };
         typedef enum commandtype CommandType;
 
 
@@ -209,6 +215,21 @@ class SetPointValueCommand : public RideCommand
         double oldvalue, newvalue;
 };
 
+class SetPointValuesCommand : public RideCommand
+{
+    Q_DECLARE_TR_FUNCTIONS(SetPointValuesCommand)
+
+    public:
+        SetPointValuesCommand(RideFile *ride, int row, RideFile::SeriesType series, QVector<double> oldvalues, QVector<double> newvalues);
+        bool doCommand();
+        bool undoCommand();
+
+        // state
+        int row, count;
+        RideFile::SeriesType series;
+        QVector<double> oldvalues, newvalues;
+};
+
 class SetXDataPointValueCommand : public RideCommand
 {
     Q_DECLARE_TR_FUNCTIONS(SetXDataPointValueCommand)
@@ -282,6 +303,19 @@ class InsertPointCommand : public RideCommand
         int row;
         RideFilePoint point;
 };
+class InsertPointsCommand : public RideCommand
+{
+    Q_DECLARE_TR_FUNCTIONS(InsertPointsCommand)
+
+    public:
+        InsertPointsCommand(RideFile *ride, int row, QVector<RideFilePoint> points);
+        bool doCommand();
+        bool undoCommand();
+
+        // state
+        int row, count;
+        QVector<RideFilePoint> points;
+};
 class InsertXDataPointCommand : public RideCommand
 {
     Q_DECLARE_TR_FUNCTIONS(InsertXDataPointCommand)
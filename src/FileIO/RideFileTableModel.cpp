@@ -404,6 +404,14 @@ RideFileTableModel::beginCommand(bool undo, RideCommand *cmd)
             break;
         }
 
+        case RideCommand::InsertPoints:
+        {
+            InsertPointsCommand *is = (InsertPointsCommand *)cmd;
+            if (!undo) beginInsertRows(QModelIndex(), is->row, is->row + is->count - 1);
+            else beginRemoveRows(QModelIndex(), is->row, is->row + is->count - 1);
+            break;
+        }
+
         case RideCommand::AppendPoints:
         {
             AppendPointsCommand *ap = (AppendPointsCommand *)cmd;
@@ -428,7 +436,15 @@ RideFileTableModel::endCommand(bool undo, RideCommand *cmd)
             dataChanged(cell, cell);
             break;
         }
+        case RideCommand::SetPointValues:
+        {
+            SetPointValuesCommand *spv = (SetPointValuesCommand*)cmd;
+            int column = headingsType.indexOf(spv->series);
+            dataChanged(index(spv->row, column), index(spv->row + spv->count - 1, column));
+            break;
+        }
         case RideCommand::InsertPoint:
+        case RideCommand::InsertPoints:
             if (!undo) endInsertRows();
             else endRemoveRows();
             break;
@@ -968,6 +968,58 @@ AddIntervalDialog::findPeaks(Context *context, bool typeTime, const RideFile *ri
     results.append(_results);
 }
 
+void
+AddIntervalDialog::findPeaks(const RideFile *ride, Specification spec, RideFile::SeriesType series,
+                             const QVector<double> &windowSizeSecs, QVector<AddedInterval> &results)
+{
+    int windows = windowSizeSecs.count();
+    results.fill(AddedInterval(), windows);
+    if (ride->dataPoints().isEmpty()) return;
+
+    double secsDelta = ride->recIntSecs();
+    double length = ride->dataPoints().last()->secs + secsDelta;
+
+    QVector<const RideFilePoint*> points;
+    RideFileIterator it(const_cast<RideFile*>(ride), spec);
+    while (it.hasNext()) points << it.next();
+
+    // each window slides along the points independently, keeping its
+    // own running total so the averages match findPeaks exactly
+    QVector<int> first(windows, 0);
+    QVector<double> total(windows, 0.0);
+    QVector<bool> found(windows, false);
+
+    for (int i=0; i<points.count(); i++) {
+
+        const RideFilePoint *point = points[i];
+        double value = point->value(series);
+
+        for (int w=0; w<windows; w++) {
+
+            // ride is shorter than the window size!
+            double windowSize = windowSizeSecs[w];
+            if (windowSize > length) continue;
+
+            // Discard points until interval duration is < windowSizeSecs + secsDelta.
+            while (first[w] < i && intervalDuration(points[first[w]], point, ride) >= windowSize + secsDelta)
+                total[w] -= points[first[w]++]->value(series);
+
+            // Add points until interval duration is >= windowSize.
+            total[w] += value;
+            double duration = intervalDuration(points[first[w]], point, ride);
+
+            // highest average wins, the earliest if there is a tie
+            if (duration >= windowSize) {
+                double avg = total[w] * secsDelta / duration;
+                if (!found[w] || avg > results[w].avg) {
+                    results[w] = AddedInterval(points[first[w]]->secs, point->secs, avg);
+                    found[w] = true;
+                }
+            }
+        }
+    }
+}
+
 void
 AddIntervalDialog::addClicked()
 {
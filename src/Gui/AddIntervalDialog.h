@@ -56,6 +56,11 @@ class AddIntervalDialog : public QDialog
                               RideFile::Conversion conversion, double windowSizeSecs,
                               int maxIntervals, QList<AddedInterval> &results, QString prefixe, QString overideName);
 
+        // the single best interval for each of the durations (secs) in one pass over the ride,
+        // same as calling findPeaks for each, but unnamed, stop is 0 if there isn't one
+        static void findPeaks(const RideFile *ride, Specification spec, RideFile::SeriesType series,
+                              const QVector<double> &windowSizeSecs, QVector<AddedInterval> &results);
+
         static void findFirsts(bool typeTime, const RideFile *ride, double windowSizeSecs,
                                int maxIntervals, QList<AddedInterval> &results);
 
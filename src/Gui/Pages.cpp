@@ -3924,6 +3924,7 @@ ProcessorPage::saveClicked()
         appsettings->setValue(GC_QSETTINGS_GLOBAL_GENERAL+configsetting, apply);
         ((DataProcessorConfig*)(processorTree->itemWidget(processorTree->invisibleRootItem()->child(i), 2)))->saveConfig();
     }
+    DataProcessorFactory::instance().configChanged();
 
     return 0;
 }
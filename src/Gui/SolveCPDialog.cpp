@@ -393,9 +393,11 @@ SolveCPDialog::newBest(int k,WBParms p,double sum)
     if (sum > 100) bsumLabel->setText("> 100kJ");
     else bsumLabel->setText(QString("%1").arg(sum, 0, 'f', 3));
 
-    // is this the end?
+    // is this the end? the chains have all stopped
+    // so we can solve again
     if (k == 0) {
-        end();
+        solve->setText(tr("Solve"));
+        solve->setEnabled(true);
     }
     QApplication::processEvents();
 }
@@ -422,8 +424,12 @@ SolveCPDialog::current(int k,WBParms p,double sum)
 void
 SolveCPDialog::end()
 {
-    solve->setText(tr("Solve"));
     solver->stop();
+
+    // the solver says when it has stopped with newBest(0,...)
+    // until then we can't start again
+    if (solver->isRunning()) solve->setEnabled(false);
+    else solve->setText(tr("Solve"));
 }
 
 void
@@ -434,6 +440,9 @@ SolveCPDialog::solveClicked()
         return;
     }
 
+    // still stopping the last one
+    if (solver->isRunning()) return;
+
     // loop through the table and collect the rides to solve
     QList<RideItem*> solveme;
 
@@ -485,6 +494,12 @@ SolveCPDialog::solveClicked()
         solver->setData(constraints, solveme);
         solve->setText(tr("Stop"));
         solver->start();
+
+        // in case there was nothing to solve
+        if (!solver->isRunning()) {
+            solve->setText(tr("Solve"));
+            solve->setEnabled(true);
+        }
     }
     return;
 }
@@ -214,8 +214,8 @@ class TimeRiding : public RideMetric {
             // loop through and count
             RideFileIterator it(item->ride(), spec);
             while (it.hasNext()) {
-                struct RideFilePoint *point = it.next();
-                if ((point->kph > 0.0) || (point->cad > 0.0))
+                it.next();
+                if ((it.value(RideFile::kph) > 0.0) || (it.value(RideFile::cad) > 0.0))
                     secsMovingOrPedaling += item->ride()->recIntSecs();
             }
         }
@@ -895,15 +895,12 @@ class TotalWork : public RideMetric {
             return;
         }
 
-        joules = 0;
-
+        // from the prefix sums, no need to go through the samples
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-
-            if (point->watts >= 0.0)
-                joules += point->watts * item->ride()->recIntSecs();
-        }
+        double watts;
+        int samples;
+        item->ride()->sum(RideFile::watts, RideFile::NonNegative, it.firstIndex(), it.lastIndex(), watts, samples);
+        joules = watts * item->ride()->recIntSecs();
         setValue(joules/1000);
     }
 
@@ -952,8 +949,8 @@ class AvgSpeed : public RideMetric {
 
             RideFileIterator it(item->ride(), spec);
             while (it.hasNext()) {
-                struct RideFilePoint *point = it.next();
-                if (point->kph > 0.0) secsMoving += item->ride()->recIntSecs();
+                it.next();
+                if (it.value(RideFile::kph) > 0.0) secsMoving += item->ride()->recIntSecs();
             }
 
             setValue(secsMoving ? km / secsMoving * 3600.0 : 0.0);
@@ -1011,15 +1008,11 @@ struct AvgPower : public RideMetric {
 
         total = count = 0;
     
+        // from the prefix sums, no need to go through the samples
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-
-            if (point->watts >= 0.0) {
-                total += point->watts;
-                ++count;
-            }
-        }
+        int samples;
+        item->ride()->sum(RideFile::watts, RideFile::NonNegative, it.firstIndex(), it.lastIndex(), total, samples);
+        count = samples;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -1069,10 +1062,11 @@ struct AvgSmO2 : public RideMetric {
 
         RideFileIterator it(item->ride(), spec);
         while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
+            it.next();
 
-            if (point->smo2 > 0.0f) {  // SmO2 should always be > 0.0f
-                total += point->smo2;
+            double smo2 = it.value(RideFile::smo2);
+            if (smo2 > 0.0f) {  // SmO2 should always be > 0.0f
+                total += smo2;
                 ++count;
             }
         }
@@ -1123,14 +1117,11 @@ struct AvgtHb : public RideMetric {
 
         total = count = 0.0f;
 
+        // from the prefix sums, no need to go through the samples
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-            if (point->thb > 0.0f) {
-                total += point->thb;
-                ++count;
-            }
-        }
+        int samples;
+        item->ride()->sum(RideFile::thb, RideFile::Positive, it.firstIndex(), it.lastIndex(), total, samples);
+        count = samples;
         setValue(count > 0.0f ? total / count : 0.0f);
         setCount(count);
     }
@@ -1179,14 +1170,11 @@ struct AAvgPower : public RideMetric {
 
         total = count = 0;
 
+        // from the prefix sums, no need to go through the samples
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-            if (point->apower >= 0.0) {
-                total += point->apower;
-                ++count;
-            }
-        }
+        int samples;
+        item->ride()->sum(RideFile::aPower, RideFile::NonNegative, it.firstIndex(), it.lastIndex(), total, samples);
+        count = samples;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -1233,14 +1221,11 @@ struct NonZeroPower : public RideMetric {
 
         total = count = 0;
 
+        // from the prefix sums, no need to go through the samples
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-            if (point->watts > 0.0) {
-                total += point->watts;
-                ++count;
-            }
-        }
+        int samples;
+        item->ride()->sum(RideFile::watts, RideFile::Positive, it.firstIndex(), it.lastIndex(), total, samples);
+        count = samples;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -1287,14 +1272,11 @@ struct AvgHeartRate : public RideMetric {
         }
 
         total = count = 0;
+        // from the prefix sums, no need to go through the samples
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-            if (point->hr > 0) {
-                total += point->hr;
-                ++count;
-            }
-        }
+        int samples;
+        item->ride()->sum(RideFile::hr, RideFile::Positive, it.firstIndex(), it.lastIndex(), total, samples);
+        count = samples;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -1342,15 +1324,11 @@ struct AvgCoreTemp : public RideMetric {
 
         total = count = 0;
 
+        // from the prefix sums, no need to go through the samples
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-
-            if (point->tcore > 0) {
-                total += point->tcore;
-                ++count;
-            }
-        }
+        int samples;
+        item->ride()->sum(RideFile::tcore, RideFile::Positive, it.firstIndex(), it.lastIndex(), total, samples);
+        count = samples;
         setValue(count > 0 ? total / count : 0);
         setCount(count);
     }
@@ -1696,14 +1674,11 @@ struct AvgCadence : public RideMetric {
 
         total = count = 0;
 
+        // from the prefix sums, no need to go through the samples
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-            if (point->cad > 0) {
-                total += point->cad;
-                ++count;
-            }
-        }
+        int samples;
+        item->ride()->sum(RideFile::cad, RideFile::Positive, it.firstIndex(), it.lastIndex(), total, samples);
+        count = samples;
         setValue(count > 0 ? total / count : count);
         setCount(count);
     }
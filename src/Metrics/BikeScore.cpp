@@ -80,8 +80,17 @@ class XPower : public RideMetric {
         double total = 0.0;
         int count = 0;
 
+        // the whole ride, the weighted average is shared
+        bool whole = spec.interval() == NULL;
+        if (whole) {
+
+            QVector<double> weights = item->ride()->transformed(RideFile::watts, RideFile::EWMA, 25.0);
+            for (int i=0; i<weights.count(); i++) total += pow(weights[i], 4.0);
+            count = weights.count();
+        }
+
         RideFileIterator it(item->ride(), spec);
-        while (it.hasNext()) {
+        while (!whole && it.hasNext()) {
             struct RideFilePoint *point = it.next();
 
             while ((weighted > NEGLIGIBLE)
@@ -18,18 +18,151 @@
 
 
 #include "CPSolver.h"
+#include "TaskPool.h"
+
+#include <QThread>
+#include <QRunnable>
+#include <QCoreApplication>
 #include <ctime>
 
+// each chain has its own random numbers, rand() is shared by all threads
+// this is the same generator as the example rand() in the C standard
+static const int SolverRandMax = 32767;
+static int
+solverRandom(quint32 &seed)
+{
+    seed = seed * 1103515245 + 12345;
+    return int((seed / 65536) % 32768);
+}
+
+// how many candidates we keep for display between updates
+static const int SolverSteps = 512;
+
+// a batch of annealing chains, run in lockstep so each pass
+// over the data computes W'bal for every chain in the batch
+class CPSolverChains : public QRunnable {
+
+    public:
+
+        CPSolverChains(CPSolver *solver, int n, bool first, quint32 seed) :
+            solver(solver), n(n), first(first), seed(seed) {}
+
+        void run();
+
+    private:
+
+        CPSolver *solver;
+        int n; // chains in the batch
+        bool first; // first batch starts first chain at the maximals
+        quint32 seed;
+};
+
+void
+CPSolverChains::run()
+{
+    const CPSolverConstraints &c = solver->constraints;
+
+    // starting conditions
+    WBParms s[CPSolver::BatchSize], snew[CPSolver::BatchSize];
+    double E[CPSolver::BatchSize], Enew[CPSolver::BatchSize];
+    for (int i=0; i<n; i++) {
+        if (first && i == 0) {
+            s[i] = solver->s0;
+        } else {
+            s[i].CP = c.cpf + int(double(c.cpto - c.cpf) * solverRandom(seed) / SolverRandMax);
+            s[i].W = c.wf + int(double(c.wto - c.wf) * solverRandom(seed) / SolverRandMax);
+            s[i].TAU = c.tf + int(double(c.tto - c.tf) * solverRandom(seed) / SolverRandMax);
+        }
+    }
+    solver->cost(s, E, n);
+
+    // 100,000 iterations at most
+    int kmax = 100000;
+
+    // give up when we're on it or run out of loops
+    for (int k=0; solver->halted() == false && k < kmax; k++) {
+
+        for (int i=0; i<n; i++) snew[i] = solver->neighbour(s[i], k, kmax, seed);
+        solver->cost(snew, Enew, n);
+
+        // probability - always 1 if better, but randomly accept higher
+        double temp = solver->temperature(double(k)/double(kmax));
+        int best = -1;
+        for (int i=0; i<n; i++) {
+
+            double random = double(solverRandom(seed)%101)/100.00f;
+            double prob = solver->probability(E[i],Enew[i],temp);
+
+            if (prob > random) {
+                s[i] = snew[i];
+                E[i] = Enew[i];
+            }
+            if (best < 0 || E[i] < E[best]) best = i;
+        }
+
+        // let start() know how we're doing
+        solver->progress.lock();
+        int step = ++solver->iterations;
+        if (solver->steps.count() < SolverSteps) {
+            CPSolver::Step add;
+            add.k = step;
+            add.parms = snew[0];
+            add.cost = Enew[0];
+            solver->steps << add;
+        }
+
+        // is it better than our very best?
+        if (E[best] < solver->Ebest) {
+            solver->Ebest = E[best];
+            solver->sbest = s[best];
+            solver->kbest = step;
+        }
+        solver->progress.unlock();
+    }
+
+    solver->progress.lock();
+    solver->running--;
+    solver->finished.wakeAll();
+    solver->progress.unlock();
+}
+
 CPSolver::CPSolver(Context *context)
    : context(context)
 {
     integral = (appsettings->value(NULL, GC_WBALFORM, "int").toString() == "int");
+    chains = qMax(1, QThread::idealThreadCount());
+    running = 0;
+}
+
+CPSolver::~CPSolver()
+{
+    // the chains use our data, wait for them
+    stop();
+    progress.lock();
+    while (running) finished.wait(&progress);
+    progress.unlock();
+}
+
+bool
+CPSolver::isRunning()
+{
+    QMutexLocker locker(&progress);
+    return running > 0;
+}
+
+bool
+CPSolver::halted()
+{
+    return halt.fetchAndAddOrdered(0) != 0;
 }
 
 // set the data to solve
 void
 CPSolver::setData(CPSolverConstraints constraints, QList<RideItem*> rides)
 {
+    // the chains are still using the data
+    if (isRunning()) return;
+
     // remember the rides
     this->constraints=constraints;
     this->rides=rides;
@@ -38,7 +171,11 @@ CPSolver::setData(CPSolverConstraints constraints, QList<RideItem*> rides)
     foreach(RideItem *item, rides) {
 
         // we don't do null well
-        if (!item || !item->ride()) continue;
+        if (!item || !item->ride() || item->ride()->referencePoints().count() == 0) continue;
+
+        // resample once for all the reference points
+        RideFile *f = item->ride()->resample(1, 0);
+        if (!f) continue;
 
         // each reference gets a separate data series
         foreach(RideFilePoint *rp, item->ride()->referencePoints()) {
@@ -49,8 +186,9 @@ CPSolver::setData(CPSolverConstraints constraints, QList<RideItem*> rides)
             // ok, now we have a point we need to get the power data
             // from the start to the point of exhaustion into a
             // 1 second sample array
-            data << power1s(item->ride(), rp->secs);
+            data << power1s(f, rp->secs);
         }
+        delete f;
     }
 }
 
@@ -61,7 +199,7 @@ CPSolver::power1s(RideFile *f, double secs)
     // its already in 1s samples so just pull it in
     QVector<int> returning;
 
-    foreach(RideFilePoint *p, f->resample(1, 0)->dataPoints()) {
+    foreach(RideFilePoint *p, f->dataPoints()) {
         if (p->secs < secs) returning << p->watts;
         else break;
     }
@@ -72,57 +210,110 @@ CPSolver::power1s(RideFile *f, double secs)
 // compute the cost, using the settings passed
 double
 CPSolver::cost(WBParms parms)
+{
+    double returning;
+    cost(&parms, &returning, 1);
+    return returning;
+}
+
+void
+CPSolver::cost(const WBParms *parms, double *costs, int n)
 {
     // returning sum(W'bal ^ 2)
 
     // loop through each ride for now, but avoid foreach()
     // since it will make a copy of the contents which has
     // a significant performance impact
-    double sumwb2=0;
-    for(int i=0; i<data.count();i++)  sumwb2 += pow(compute(data[i], parms),2);
+    double sumwb2[BatchSize], wpbal[BatchSize];
+    for(int c=0; c<n; c++) sumwb2[c] = 0;
+    for(int i=0; i<data.count();i++) {
+        compute(data.at(i), parms, wpbal, n);
+        for(int c=0; c<n; c++) sumwb2[c] += pow(wpbal[c],2);
+    }
 
     //qDebug()<<"cost="<<QString("%1").arg(sumwb2, 0, 'g', 7);
 
     // what we got - normalise to number of fits
-    return (sumwb2/data.count()) /1000.0f;
+    for(int c=0; c<n; c++) costs[c] = (sumwb2[c]/data.count()) /1000.0f;
 }
 
 double
-CPSolver::compute(QVector<int> &ride, WBParms parms)
+CPSolver::compute(const QVector<int> &ride, WBParms parms)
 {
-    // compute w'bal for the ride using the paramters
-    // XXX for now we use the integral model
-    double I=0.00f;
-    int t=0;
-    double wpbal=parms.W;
-    foreach(int watts, ride) {
+    double returning;
+    compute(ride, &parms, &returning, 1);
+    return returning;
+}
 
-        if (integral) {
+void
+CPSolver::compute(const QVector<int> &ride, const WBParms *parms, double *wpbal, int n)
+{
+    const int *watts = ride.constData();
+    const int count = ride.count();
 
-            // INTEGRAL
-            I += exp(((double)(t) / parms.TAU)) * (watts > parms.CP ? watts-parms.CP : 0);
-            wpbal = parms.W - (exp(-((double)(t) / parms.TAU)) * I);
+    double CP[BatchSize], W[BatchSize];
+    for (int c=0; c<n; c++) {
+        CP[c] = parms[c].CP;
+        W[c] = parms[c].W;
+    }
 
-        } else {
+    if (integral) {
+
+        // INTEGRAL
+        // we only need W'bal at the end, which is
+        //      W' - sum(exp(-(T-t)/tau) * (watts(t) > CP ? watts(t)-CP : 0))
+        // the sum is accumulated with one multiply a sample
+        // instead of two exp() a sample
+        double decay[BatchSize], I[BatchSize];
+        for (int c=0; c<n; c++) {
+            decay[c] = exp(-1.0 / parms[c].TAU);
+            I[c] = 0;
+        }
+        for (int t=0; t<count; t++) {
+            const double w = watts[t];
+            for (int c=0; c<n; c++) I[c] = (I[c] * decay[c]) + (w > CP[c] ? w-CP[c] : 0);
+        }
+        for (int c=0; c<n; c++) wpbal[c] = W[c] - I[c];
 
+    } else {
 
-            // DIFFERENTIAL
-            wpbal  += watts < parms.CP ? ((double(parms.TAU)/100.0f) * (parms.W - wpbal)/parms.W * (parms.CP - watts) ) : (parms.CP-watts);
+        // DIFFERENTIAL
+        double R[BatchSize], bal[BatchSize];
+        for (int c=0; c<n; c++) {
+            R[c] = double(parms[c].TAU)/100.0f;
+            bal[c] = W[c];
         }
+        if (n == 1) {
+
+            // a branch is quicker than computing the recovery
+            // for every sample when there is only one chain
+            for (int t=0; t<count; t++) {
+                const double w = watts[t];
+                if (w < CP[0]) bal[0] += R[0] * (W[0] - bal[0])/W[0] * (CP[0] - w);
+                else bal[0] += CP[0]-w;
+            }
 
-        t++;
+        } else {
+
+            for (int t=0; t<count; t++) {
+                const double w = watts[t];
+                for (int c=0; c<n; c++)
+                    bal[c] += w < CP[c] ? (R[c] * (W[c] - bal[c])/W[c] * (CP[c] - w)) : (CP[c]-w);
+            }
+        }
+        for (int c=0; c<n; c++) wpbal[c] = bal[c];
     }
 
     // we solve for W'bal=500 as it is not possible to completely
     // exhaust W', 500 is the point at which most athletes will
     // fail to continue, on average.
     // See: http://www.ncbi.nlm.nih.gov/pubmed/24509723
-    return wpbal - 500;
+    for (int c=0; c<n; c++) wpbal[c] -= 500;
 }
 
 // get us a neighbour
 WBParms
-CPSolver::neighbour(WBParms p, int k, int kmax)
+CPSolver::neighbour(WBParms p, int k, int kmax, quint32 &seed)
 {
     WBParms returning;
 
@@ -142,13 +333,13 @@ CPSolver::neighbour(WBParms p, int k, int kmax)
     int TAUrange = 3 + ((constraints.tto - constraints.tf) * factor);
     int it=0;
 
-    // scale rand() to our range (32767 is typical for RAND_MAX)
-    double f = double(Wrange) / double(RAND_MAX);
+    // scale random numbers to our range
+    double f = double(Wrange) / double(SolverRandMax);
 
     do {
-        returning.CP = p.CP + (rand()%CPrange - (CPrange/2));
-        returning.W = p.W + (int(double(rand())*f)%Wrange - (Wrange/2));
-        returning.TAU = p.TAU + (rand()%TAUrange - (TAUrange/2));
+        returning.CP = p.CP + (solverRandom(seed)%CPrange - (CPrange/2));
+        returning.W = p.W + (int(double(solverRandom(seed))*f)%Wrange - (Wrange/2));
+        returning.TAU = p.TAU + (solverRandom(seed)%TAUrange - (TAUrange/2));
 
     } while (it++ < 3 && (returning.CP < constraints.cpf || returning.CP > constraints.cpto ||
                           returning.W > constraints.cpto || returning.W < constraints.cpf ||
@@ -168,6 +359,13 @@ CPSolver::neighbour(WBParms p, int k, int kmax)
 void
 CPSolver::reset()
 {
+    // the chains are still using the data, so just stop
+    // them, it will be cleared when we are next reset
+    if (isRunning()) {
+        stop();
+        return;
+    }
+
     rides.clear();
     data.clear();
 }
@@ -178,8 +376,11 @@ CPSolver::start()
     // set starting conditions from first ride
     if (data.count() == 0 || rides.count() == 0) return;
 
+    // the last run's chains haven't finished yet
+    if (isRunning()) return;
+
     // to flag when to stop
-    halt = false;
+    halt.fetchAndStoreOrdered(0);
 
     // set starting conditions at maximals
     s0.CP =   constraints.cpto;
@@ -190,49 +391,53 @@ CPSolver::start()
     p.start();
 
     // initial conditions
-    srand((unsigned int) time (NULL)); // seed ONCE!
-    double E = cost(s0);
-    double Ebest = E;
-    WBParms s = s0;
-    WBParms sbest = s;
-
-    // 10,000 iterations at most
-    int k=0;
-    int kmax = 100000;
-
-    // give up when we're on it or run out of loops
-    while (halt == false && k < kmax) {
-
-        WBParms snew = neighbour(s, k, kmax);
-        double Enew = cost(snew);
-
-        // progress update k=0 means stop so we offset by one
-        emit current(k+1, snew,Enew);
-
-        // probability - always 1 if better, but randomly accept higher
-        double random = double(rand()%101)/100.00f;
-        double temp = temperature(double(k)/double(kmax));
-        double prob = probability(E,Enew,temp);
-
-        if (prob > random) {
-            s = snew;
-            E = Enew;
-        }
-
-        // is it better than our very best?
-        if (E < Ebest) {
-            Ebest = E;
-            sbest = s;
-
-            // k of zero means stop so we offset by one
-            emit newBest(k+1, sbest, Ebest);
-            //qDebug()<<k<<"new best"<<Ebest <<s.CP<<s.W<<s.TAU;
+    sbest = s0;
+    Ebest = cost(s0);
+    iterations = kbest = 0;
+    steps.clear();
+
+    // kick off the chains in the thread pool, spread across the cores
+    // and only batched when there are more chains than cores, a batch
+    // of 4 chains costs more than one chain a step
+    int threads = qMax(1, QThread::idealThreadCount());
+    int batch = qMin(int(BatchSize), (chains + threads - 1) / threads);
+    quint32 seed = (quint32) time (NULL);
+    TaskGroup group;
+
+    progress.lock();
+    running = (chains + batch - 1) / batch;
+    progress.unlock();
+    for (int i=0; i<chains; i += batch)
+        group.submit(new CPSolverChains(this, qMin(batch, chains-i), i == 0, seed + (i * 7919)));
+
+    // report progress whilst they run, we are called
+    // from the gui so keep it responsive whilst we wait
+    bool done = false;
+    while (!done) {
+
+        progress.lock();
+        QVector<Step> latest = steps;
+        steps.clear();
+        int k = kbest;
+        WBParms best = sbest;
+        double E = Ebest;
+        kbest = 0;
+        done = (running == 0);
+        progress.unlock();
+
+        // iterations count from one, k of zero means stop
+        foreach(const Step &step, latest) emit current(step.k, step.parms, step.cost);
+        if (k) emit newBest(k, best, E);
+
+        if (!done) {
+            QCoreApplication::processEvents();
+
+            progress.lock();
+            if (running) finished.wait(&progress, 10);
+            progress.unlock();
         }
-
-        // don't run forever
-        k++;
-
     }
+    group.wait();
 
     // k of zero means stop
     emit newBest(0, sbest,Ebest);
@@ -260,7 +465,7 @@ CPSolver::pause()
 void
 CPSolver::stop()
 {
-    halt = true;
+    halt.fetchAndStoreOrdered(1);
 }
 
 // Metric of best 'R' for first exhaustion point in a ride
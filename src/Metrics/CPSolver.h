@@ -29,8 +29,12 @@
 #include <QList>
 #include <QVector>
 #include <QObject>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
 
 class Context;
+class CPSolverChains;
 
 // W'bal parameters passed around as a set
 class WBParms {
@@ -73,21 +77,35 @@ class CPSolver : public QObject {
         // as simulated annealing algorithm to solve W', CP and tau
         // from a collection of exhaustion points within a ride
         CPSolver(Context *);
+        ~CPSolver();
 
         // set the data to solve
         void setData(CPSolverConstraints constraints, QList<RideItem*>);
 
+        // how many annealing chains to run on the thread pool, one for
+        // each core by default; with more chains than cores they are run
+        // in batches of up to BatchSize, with every chain in a batch
+        // evaluated in the same pass over the data. The first chain starts
+        // at the maximals, the others start at random
+        enum { BatchSize = 4 };
+        void setChains(int chains) { this->chains = chains > 0 ? chains : 1; }
+
+        // chains are still running, even if asked to stop
+        bool isRunning();
+
         // compute the cost, using the settings passed
         double cost(WBParms parms);
+        void cost(const WBParms *parms, double *costs, int n); // n <= BatchSize
 
         // compute ending W'bal for the exhaustion series
-        double compute(QVector<int> &ride, WBParms parms);
+        double compute(const QVector<int> &ride, WBParms parms);
+        void compute(const QVector<int> &ride, const WBParms *parms, double *wpbal, int n);
 
-        WBParms neighbour(WBParms, int k, int kmax);
+        WBParms neighbour(WBParms, int k, int kmax, quint32 &seed);
         double probability(double,double,double);
         double temperature(double);
 
-        // get a 1s power array from the data
+        // get a 1s power array from 1s data
         QVector<int> power1s(RideFile *f, double secs);
 
     signals:
@@ -105,10 +123,13 @@ class CPSolver : public QObject {
 
     private:
 
+        friend class ::CPSolverChains;
+
         // who we for ?
         Context *context;
         CPSolverConstraints constraints;
         bool integral;
+        int chains;
 
         // an array of power data leading up to each exhaust point
         QList<QVector<int> > data;
@@ -117,8 +138,22 @@ class CPSolver : public QObject {
         // annealling parms
         WBParms s0, sbest;
 
-        // to signal we need to stop
-        bool halt;
+        // progress from the chains, reported by start()
+        struct Step {
+            int k;
+            WBParms parms;
+            double cost;
+        };
+        QMutex progress;
+        QWaitCondition finished; // a batch of chains finished
+        QVector<Step> steps; // recent candidates, for display
+        int iterations, running;
+        double Ebest;
+        int kbest; // 0 if no new best since last reported
+
+        // to signal we need to stop, polled by the chains
+        QAtomicInt halt;
+        bool halted();
 };
 
 #endif
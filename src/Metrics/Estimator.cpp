@@ -23,6 +23,11 @@
 #include "RideFileCache.h"
 #include "RideCacheModel.h"
 #include "Specification.h"
+#include "TaskPool.h"
+
+#include <QRunnable>
+#include <QFile>
+#include <QDataStream>
 
 #ifndef ESTIMATOR_DEBUG
 #define ESTIMATOR_DEBUG false
@@ -97,7 +102,116 @@ class RollingBests {
         }
 };
 
-Estimator::Estimator(Context *context) : context(context)
+// fingerprint of the bests a fit is made from, FNV-1a over the values
+static quint64
+estimatorFingerprint(const QVector<float> &values, quint64 hash=14695981039346656037ULL)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(values.constData());
+    const int n = values.size() * sizeof(float);
+    for (int i=0; i<n; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    // so an empty vector still changes the hash
+    hash ^= quint64(values.size());
+    hash *= 1099511628211ULL;
+    return hash;
+}
+
+// fit all the models to a week's rolling bests, each week is
+// fitted with its own models so weeks can be fitted in parallel
+class EstimatorWeek : public QRunnable {
+
+    public:
+
+        EstimatorWeek(Context *context, QDate begin, QDate end, QVector<float> bests, QVector<float> bestsWPK) :
+            begin(begin), end(end), fingerprint(0), context(context), bests(bests), bestsWPK(bestsWPK) {}
+
+        void run();
+
+        QDate begin, end;
+        quint64 fingerprint; // of the bests
+        QList<PDEstimate> estimates; // results
+
+    private:
+
+        Context *context;
+        QVector<float> bests, bestsWPK;
+};
+
+void
+EstimatorWeek::run()
+{
+    // set up the models we support
+    CP2Model p2model(context);
+    CP3Model p3model(context);
+    WSModel wsmodel(context);
+    MultiModel multimodel(context);
+    ExtendedModel extmodel(context);
+
+    QList <PDModel *> models;
+    models << &p2model;
+    models << &p3model;
+    models << &multimodel;
+    models << &extmodel;
+    models << &wsmodel;
+
+    foreach(PDModel *model, models) {
+
+        PDEstimate add;
+
+        // set the data
+        model->setData(bests);
+        model->saveParameters(add.parameters); // save the computed parms
+
+        add.wpk = false;
+        add.from = begin;
+        add.to = end;
+        add.model = model->code();
+        add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
+        add.CP = model->hasCP() ? model->CP() : 0;
+        add.PMax = model->hasPMax() ? model->PMax() : 0;
+        add.FTP = model->hasFTP() ? model->FTP() : 0;
+
+        if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
+
+        // so long as the important model derived values are sensible ...
+        if (add.WPrime > 1000 && add.CP > 100) {
+            printd("Estimates for %s - %s\n", add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str());
+            estimates << add;
+        }
+
+        //qDebug()<<add.to<<add.from<<model->code()<< "W'="<< model->WPrime() <<"CP="<< model->CP() <<"pMax="<<model->PMax();
+
+        // set the wpk data
+        model->setData(bestsWPK);
+        model->saveParameters(add.parameters); // save the computed parms
+
+        add.wpk = true;
+        add.from = begin;
+        add.to = end;
+        add.model = model->code();
+        add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
+        add.CP = model->hasCP() ? model->CP() : 0;
+        add.PMax = model->hasPMax() ? model->PMax() : 0;
+        add.FTP = model->hasFTP() ? model->FTP() : 0;
+        if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
+
+        // so long as the model derived values are sensible ...
+        if ((!model->hasWPrime() || add.WPrime > 10.0f) &&
+            (!model->hasCP() || add.CP > 1.0f) &&
+            (!model->hasPMax() || add.PMax > 1.0f) &&
+            (!model->hasFTP() || add.FTP > 1.0f)) {
+            printd("WPK Estimates for %s - %s\n", add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str());
+            estimates << add;
+        }
+
+        //qDebug()<<add.from<<model->code()<< "KG W'="<< model->WPrime() <<"CP="<< model->CP() <<"pMax="<<model->PMax();
+    }
+}
+
+Estimator::Estimator(Context *context) : context(context), loaded(false)
 {
     // used to flag when we need to stop
     abort = false;
@@ -205,29 +319,34 @@ Estimator::run()
         return;
     }
 
-    // set up the models we support
-    CP2Model p2model(context);
-    CP3Model p3model(context);
-    WSModel wsmodel(context);
-    MultiModel multimodel(context);
-    ExtendedModel extmodel(context);
+    // saved fits from last time
+    if (!loaded) load();
 
-    QList <PDModel *> models;
-    models << &p2model;
-    models << &p3model;
-    models << &multimodel;
-    models << &extmodel;
-    models << &wsmodel;
+    // each week that needs fitting is fitted by its own task, with its own
+    // models, so the weeks are fitted in parallel; we wait for them in
+    // batches to limit the number of aggregates held in memory
+    const int batchsize = qMax(1, QThread::idealThreadCount()) * 2;
+    QList<EstimatorWeek*> batch;
+    TaskGroup fitting;
 
+    // the fits we have now, weeks no longer in range are dropped
+    QMap<QDate, WeekFit> fitted;
+    bool changed = false;
+    int reused = 0;
 
     // from has first ride with Power data / looking at the next 7 days of data with Power
     // calculate Estimates for all data per week including the week of the last Power recording
-    QDate date = from;
+    // weeks start on a monday so the bests come straight from the mean max index,
+    // this used to be 7 day blocks from the first ride with power, so an estimate's
+    // from/to dates can move by up to 6 days compared to older versions
+    QDate date = from.addDays(1 - from.dayOfWeek());
     while (date < to) {
 
         // check if we've been asked to stop
         if (abort == true) {
             printd("Model estimator aborted.\n");
+            fitting.wait();
+            qDeleteAll(batch);
             abort = false;
             return;
         }
@@ -244,64 +363,52 @@ Estimator::run()
         bests.addBests(RideFileCache::meanMaxPowerFor(context, wpk, begin, end, false));
         bestsWPK.addBests(wpk);
 
-        // we now have the data
-        foreach(PDModel *model, models) {
+        // the fit only depends upon the aggregated bests, if they
+        // are the same as last time then so are the estimates
+        QVector<float> aggregate = bests.aggregate();
+        QVector<float> aggregateWPK = bestsWPK.aggregate();
+        quint64 fingerprint = estimatorFingerprint(aggregateWPK, estimatorFingerprint(aggregate));
 
-            PDEstimate add;
+        if (fits.contains(begin) && fits.value(begin).fingerprint == fingerprint) {
 
-            // set the data
-            model->setData(bests.aggregate());
-            model->saveParameters(add.parameters); // save the computed parms
-
-            add.wpk = false;
-            add.from = begin;
-            add.to = end;
-            add.model = model->code();
-            add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
-            add.CP = model->hasCP() ? model->CP() : 0;
-            add.PMax = model->hasPMax() ? model->PMax() : 0;
-            add.FTP = model->hasFTP() ? model->FTP() : 0;
-
-            if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
-
-            // so long as the important model derived values are sensible ...
-            if (add.WPrime > 1000 && add.CP > 100) {
-                printd("Estimates for %s - %s\n", add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str());
-                est << add;
-            }
+            fitted.insert(begin, fits.value(begin));
+            reused++;
 
-            //qDebug()<<add.to<<add.from<<model->code()<< "W'="<< model->WPrime() <<"CP="<< model->CP() <<"pMax="<<model->PMax();
-
-            // set the wpk data
-            model->setData(bestsWPK.aggregate());
-            model->saveParameters(add.parameters); // save the computed parms
-
-            add.wpk = true;
-            add.from = begin;
-            add.to = end;
-            add.model = model->code();
-            add.WPrime = model->hasWPrime() ? model->WPrime() : 0;
-            add.CP = model->hasCP() ? model->CP() : 0;
-            add.PMax = model->hasPMax() ? model->PMax() : 0;
-            add.FTP = model->hasFTP() ? model->FTP() : 0;
-            if (add.CP && add.WPrime) add.EI = add.WPrime / add.CP ;
-
-            // so long as the model derived values are sensible ...
-            if ((!model->hasWPrime() || add.WPrime > 10.0f) &&
-                (!model->hasCP() || add.CP > 1.0f) &&
-                (!model->hasPMax() || add.PMax > 1.0f) &&
-                (!model->hasFTP() || add.FTP > 1.0f)) {
-                printd("WPK Estimates for %s - %s\n", add.from.toString().toStdString().c_str(), add.to.toString().toStdString().c_str());
-                est << add;
-            }
+        } else {
 
-            //qDebug()<<add.from<<model->code()<< "KG W'="<< model->WPrime() <<"CP="<< model->CP() <<"pMax="<<model->PMax();
+            // we now have the data, fit the models for this week
+            EstimatorWeek *week = new EstimatorWeek(context, begin, end, aggregate, aggregateWPK);
+            week->fingerprint = fingerprint;
+            week->setAutoDelete(false);
+            fitting.submit(week);
+            batch << week;
         }
 
         // go forward a week
         date = date.addDays(7);
+
+        // collect the fits
+        if (batch.count() >= batchsize || (date >= to && batch.count())) {
+            fitting.wait();
+            foreach(EstimatorWeek *week, batch) {
+                WeekFit &fit = fitted[week->begin];
+                fit.fingerprint = week->fingerprint;
+                fit.estimates = week->estimates;
+            }
+            qDeleteAll(batch);
+            batch.clear();
+            changed = true;
+        }
     }
 
+    // some of what we had is for weeks we no longer have
+    if (reused != fits.count()) changed = true;
+    fits = fitted;
+    if (changed) save();
+
+    // in date order
+    foreach(const WeekFit &fit, fits) est << fit.estimates;
+
     // add a dummy entry if we have no estimates to stop constantly trying to refresh
     if (est.count() == 0)  est << PDEstimate();
 
@@ -312,3 +419,61 @@ Estimator::run()
 
     printd("Estimates end\n");
 }
+
+void
+Estimator::load()
+{
+    loaded = true;
+
+    QFile file(context->athlete->home->cache().canonicalPath() + "/estimates.dat");
+    if (!file.open(QFile::ReadOnly)) return;
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_4_6);
+
+    quint32 version, count;
+    in >> version >> count;
+    if (version != EstimatorCacheVersion) return;
+
+    for (quint32 i=0; i<count && in.status() == QDataStream::Ok; i++) {
+
+        QDate week;
+        WeekFit fit;
+        quint32 estimates;
+        in >> week >> fit.fingerprint >> estimates;
+
+        for (quint32 j=0; j<estimates && in.status() == QDataStream::Ok; j++) {
+            PDEstimate add;
+            in >> add.from >> add.to >> add.model >> add.WPrime >> add.CP >> add.FTP
+               >> add.PMax >> add.EI >> add.wpk >> add.parameters;
+            fit.estimates << add;
+        }
+        fits.insert(week, fit);
+    }
+
+    // all or nothing
+    if (in.status() != QDataStream::Ok) fits.clear();
+}
+
+void
+Estimator::save()
+{
+    QFile file(context->athlete->home->cache().canonicalPath() + "/estimates.dat");
+    if (!file.open(QFile::WriteOnly | QFile::Truncate)) return;
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_4_6);
+
+    out << EstimatorCacheVersion << quint32(fits.count());
+
+    QMapIterator<QDate, WeekFit> it(fits);
+    while (it.hasNext()) {
+        it.next();
+        out << it.key() << it.value().fingerprint << quint32(it.value().estimates.count());
+        foreach(const PDEstimate &add, it.value().estimates) {
+            out << add.from << add.to << add.model << add.WPrime << add.CP << add.FTP
+                << add.PMax << add.EI << add.wpk << add.parameters;
+        }
+    }
+    file.close();
+}
@@ -26,11 +26,20 @@
 
 #include <QThread>
 #include <QMutex>
+#include <QMap>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #include <QScrollArea>
 #include <QPushButton>
 
+// revision history:
+// version  date         description
+// 1        16-Oct-18    Initial - fits by week
+//
+// the saved fits are only as good as the models that made them,
+// so bump the version whenever the models or their fitting change
+static const quint32 EstimatorCacheVersion = 1;
+
 class Estimator : public QThread {
 
     Q_OBJECT
@@ -65,6 +74,23 @@ class Estimator : public QThread {
         QTimer singleshot;
 
         bool abort;
+
+    private:
+
+        // the fits for each week (keyed by its monday) are kept, and saved
+        // to cache/estimates.dat, with a fingerprint of the rolling bests
+        // they were fitted to, so only weeks whose 12 week window saw a
+        // change in the data need to be fitted again
+        struct WeekFit {
+            WeekFit() : fingerprint(0) {}
+            quint64 fingerprint;
+            QList<PDEstimate> estimates;
+        };
+        QMap<QDate, WeekFit> fits;
+        bool loaded;
+
+        void load();
+        void save();
 };
 
 #endif
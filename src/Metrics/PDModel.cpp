@@ -17,7 +17,7 @@
  */
 
 #include "PDModel.h"
-#include "lmcurve.h"
+#include "lmmin.h"
 
 // base class for all models
 PDModel::PDModel(Context *context) :
@@ -124,11 +124,28 @@ PDModel::setIntervals(double sanI1, double sanI2, double anI1, double anI2,
     emit intervalsChanged();
 }
 
-// used to wrap a function call when deriving parameters
-QMutex calllmfit;
-static PDModel *calllmfitmodel = NULL;
-static double calllmfitf(double t, const double *p) {
-    return static_cast<PDModel*>(calllmfitmodel)->f(t, p);
+// lmcurve's callback has no user data, so we call lmmin directly
+// and pass the model and data with each fit, that way fits can run
+// on many threads at once without any locking
+struct PDModelFit {
+    PDModel *model;
+    const double *t, *y;
+};
+
+static void
+pdModelEvaluate(const double *par, const int m_dat, const void *data, double *fvec, int *)
+{
+    const PDModelFit *fit = static_cast<const PDModelFit*>(data);
+    for (int i = 0; i < m_dat; i++)
+        fvec[i] = fit->y[i] - fit->model->f(fit->t[i], par);
+}
+
+static void
+pdModelFit(PDModel *model, double *par, const QVector<double> &t, const QVector<double> &p,
+           const lm_control_struct *control, lm_status_struct *status)
+{
+    PDModelFit fit = { model, t.constData(), p.constData() };
+    lmmin(model->nparms(), par, p.count(), NULL, &fit, pdModelEvaluate, control, status);
 }
 
 // using the data and intervals from above, derive the
@@ -226,15 +243,8 @@ PDModel::deriveCPParameters(int model)
         lm_control_struct control = lm_control_double;
         lm_status_struct status;
 
-        // use forwarder via global variable, so mutex around this !
-        calllmfit.lock();
-        calllmfitmodel = this;
-
         //fprintf(stderr, "Fitting ...\n" ); fflush(stderr);
-        lmcurve(this->nparms(), par, p.count(), t.constData(), p.constData(), calllmfitf, &control, &status);
-
-        // release for others
-        calllmfit.unlock();
+        pdModelFit(this, par, t, p, &control, &status);
 
         //fprintf(stderr, "Results:\n" );
         //fprintf(stderr, "status after %d function evaluations:\n  %s\n",
@@ -951,15 +961,8 @@ ExtendedModel::deriveExtCPParameters()
         lm_control_struct control = lm_control_double;
         lm_status_struct status;
 
-        // use forwarder via global variable, so mutex around this !
-        calllmfit.lock();
-        calllmfitmodel = this;
-
         fprintf(stderr, "Fitting ...\n" ); fflush(stderr);
-        lmcurve(this->nparms(), par, p.count(), t.constData(), p.constData(), calllmfitf, &control, &status);
-
-        // release for others
-        calllmfit.unlock();
+        pdModelFit(this, par, t, p, &control, &status);
 
         fprintf(stderr, "Results:\n" );
         fprintf(stderr, "status after %d function evaluations:\n  %s\n",
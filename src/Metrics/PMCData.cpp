@@ -34,7 +34,8 @@
 #include <QProgressDialog>
 
 PMCData::PMCData(Context *context, Specification spec, QString metricName, int stsDays, int ltsDays) 
-    : context(context), specification_(spec), metricName_(metricName), stsDays_(stsDays), ltsDays_(ltsDays), isstale(true)
+    : context(context), specification_(spec), metricName_(metricName), stsDays_(stsDays), ltsDays_(ltsDays), isstale(true), rescan_(false),
+      sbToday_(false), lastStsDays_(0), lastLtsDays_(0)
 {
     // get defaults if not passed
     useDefaults = false;
@@ -59,15 +60,16 @@ PMCData::PMCData(Context *context, Specification spec, QString metricName, int s
 
 
     refresh();
-    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(invalidate()));
-    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(invalidate()));
-    connect(context, SIGNAL(refreshUpdate(QDate)), this, SLOT(invalidate()));
-    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(invalidate()));
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(rescan()));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
+    connect(context, SIGNAL(refreshUpdate(QDate)), this, SLOT(rescan()));
+    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(rideChanged(RideItem*)));
     connect(context->athlete->seasons, SIGNAL(seasonsChanged()), this, SLOT(invalidate()));
 }
 
 PMCData::PMCData(Context *context, Specification spec, Leaf *expr, DataFilterRuntime *df, int stsDays, int ltsDays) 
-    : context(context), specification_(spec), metricName_(""), stsDays_(stsDays), ltsDays_(ltsDays), isstale(true)
+    : context(context), specification_(spec), metricName_(""), stsDays_(stsDays), ltsDays_(ltsDays), isstale(true), rescan_(false),
+      sbToday_(false), lastStsDays_(0), lastLtsDays_(0)
 {
     // get defaults if not passed
     useDefaults = false;
@@ -92,10 +94,10 @@ PMCData::PMCData(Context *context, Specification spec, Leaf *expr, DataFilterRun
 
 
     refresh();
-    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(invalidate()));
-    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(invalidate()));
-    connect(context, SIGNAL(refreshUpdate(QDate)), this, SLOT(invalidate()));
-    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(invalidate()));
+    connect(context, SIGNAL(rideAdded(RideItem*)), this, SLOT(rescan()));
+    connect(context, SIGNAL(rideDeleted(RideItem*)), this, SLOT(rideDeleted(RideItem*)));
+    connect(context, SIGNAL(refreshUpdate(QDate)), this, SLOT(rescan()));
+    connect(context->athlete->rideCache, SIGNAL(itemChanged(RideItem*)), this, SLOT(rideChanged(RideItem*)));
 }
 
 void PMCData::invalidate()
@@ -103,9 +105,73 @@ void PMCData::invalidate()
     isstale=true;
 }
 
+void PMCData::rideChanged(RideItem *item)
+{
+    pending_.insert(item);
+}
+
+void PMCData::rideDeleted(RideItem *item)
+{
+    // it will be deleted soon, so forget it now
+    pending_.remove(item);
+    if (contributions_.contains(item)) {
+        dirty_.insert(contributions_.value(item).offset);
+        contributions_.remove(item);
+    }
+}
+
+void PMCData::rescan()
+{
+    // rides added or metrics refreshed, which rides
+    // changed we don't know so check them all
+    rescan_=true;
+}
+
+bool
+PMCData::contribution(RideItem *item, Contribution &c)
+{
+    if (!specification_.pass(item)) return false;
+
+    // seed with score for this one
+    int offset = start_.daysTo(item->dateTime.date());
+    if (offset > 0 && offset < stress_.count()) {
+
+        // although metrics are cleansed, we check here because development
+        // builds have a rideDB.json that has nan and inf values in it.
+        double value = 0;;
+        if (fromDataFilter) value = expr->eval(df, expr, 0, item).number;
+        else value = item->getForSymbol(metricName_);
+
+        if (!std::isinf(value) && !std::isnan(value)) {
+            c.offset = offset;
+            c.value = value;
+            c.planned = item->planned;
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+PMCData::sumStress(int offset)
+{
+    // add up in ride order, just like a full refresh
+    stress_[offset] = 0;
+    planned_stress_[offset] = 0;
+
+    QDate date = start_.addDays(offset);
+    foreach(RideItem *item, context->athlete->rideCache->ridesBetween(date, date)) {
+        if (!contributions_.contains(item)) continue;
+
+        const Contribution &c = contributions_[item];
+        if (c.planned) planned_stress_[offset] += c.value;
+        else stress_[offset] += c.value;
+    }
+}
+
 void PMCData::refresh()
 {
-    if (!isstale) return;
+    if (!isstale && !rescan_ && pending_.isEmpty() && dirty_.isEmpty()) return;
 
     // we need to reread config if refreshing (it might have changed)
     if (useDefaults) {
@@ -118,6 +184,12 @@ void PMCData::refresh()
         if (sts.isNull() || sts.toInt() == 0) stsDays_ = 7;
         else stsDays_ = sts.toInt();
     }
+    bool sbToday = appsettings->cvalue(context->athlete->cyclist, GC_SB_TODAY).toInt();
+
+    // anything that changes every day needs a full refresh
+    if (sbToday != sbToday_ || ltsDays_ != lastLtsDays_ || stsDays_ != lastStsDays_ ||
+        today_ != QDate::currentDate())
+        isstale = true;
 
     QTime timer;
     timer.start();
@@ -144,21 +216,93 @@ void PMCData::refresh()
     }
 
     // what is earliest date we got ? (substract 1 day to include first ride)
-    start_ = QDate(9999,12,31);
-    if (seed != QDate() && seed < start_) start_ = seed;
-    if (first != QDate() && first < start_) start_ = first.addDays(-1);
+    QDate start = QDate(9999,12,31);
+    if (seed != QDate() && seed < start) start = seed;
+    if (first != QDate() && first < start) start = first.addDays(-1);
 
     // whats the latest date we got ? (and add a year for decay)
-    end_ = QDate();
-    if (last > seed) end_ = last.addDays(365);
-    else if (seed != QDate()) end_ = seed.addDays(365);
+    QDate end = QDate();
+    if (last > seed) end = last.addDays(365);
+    else if (seed != QDate()) end = seed.addDays(365);
 
     // back to null date if not set, just to get round date arithmetic
-    if (start_ == QDate(9999,12,31)) start_ = QDate();
+    if (start == QDate(9999,12,31)) start = QDate();
+
+    // if the range moved every offset is different
+    if (start != start_ || end != end_) isstale = true;
+    start_ = start;
+    end_ = end;
+
+    // remember what we refreshed with
+    sbToday_ = sbToday;
+    lastLtsDays_ = ltsDays_;
+    lastStsDays_ = stsDays_;
+    today_ = QDate::currentDate();
 
     // We got a valid range ?
     if (start_ != QDate() && end_ != QDate() && start_ < end_) {
 
+        // just the rides that changed ?
+        if (!isstale) {
+
+            // check every ride, the new contributions replace the old
+            if (rescan_) {
+                QHash<RideItem*, Contribution> contributions;
+                foreach(RideItem *item, context->athlete->rideCache->rides()) {
+                    Contribution c;
+                    if (contribution(item, c)) contributions.insert(item, c);
+                }
+                QHashIterator<RideItem*, Contribution> was(contributions_);
+                while (was.hasNext()) {
+                    was.next();
+                    if (!contributions.contains(was.key())) dirty_.insert(was.value().offset);
+                }
+                QHashIterator<RideItem*, Contribution> is(contributions);
+                while (is.hasNext()) {
+                    is.next();
+                    if (!contributions_.contains(is.key())) dirty_.insert(is.value().offset);
+                    else {
+                        const Contribution &c = contributions_[is.key()];
+                        if (c.offset != is.value().offset || c.value != is.value().value ||
+                            c.planned != is.value().planned) {
+                            dirty_.insert(c.offset);
+                            dirty_.insert(is.value().offset);
+                        }
+                    }
+                }
+                contributions_ = contributions;
+
+            } else {
+
+                // the ride may have moved, so old and new days
+                foreach(RideItem *item, pending_) {
+                    if (contributions_.contains(item)) {
+                        dirty_.insert(contributions_.value(item).offset);
+                        contributions_.remove(item);
+                    }
+                    Contribution c;
+                    if (contribution(item, c)) {
+                        contributions_.insert(item, c);
+                        dirty_.insert(c.offset);
+                    }
+                }
+            }
+
+            int from = days_;
+            foreach(int offset, dirty_) {
+                sumStress(offset);
+                if (offset < from) from = offset;
+            }
+            propagate(from);
+
+            pending_.clear();
+            dirty_.clear();
+            rescan_ = false;
+
+            //qDebug()<<"update PMC from="<<from<<"in="<<timer.elapsed()<<"ms";
+            return;
+        }
+
         // resize arrays
         days_ = start_.daysTo(end_)+1;
         stress_.resize(days_);
@@ -201,6 +345,11 @@ void PMCData::refresh()
         expected_sb_.resize(0);
         expected_rr_.resize(0);
 
+        contributions_.clear();
+        pending_.clear();
+        dirty_.clear();
+        rescan_ = false;
+        isstale = false;
 
         // give up
         return;
@@ -208,34 +357,70 @@ void PMCData::refresh()
     //qDebug()<<"refresh PMC dates:"<<metricName_<<"days="<<days_<<"start="<<start_<<"end="<<end_;
 
     //
-    // STEP TWO What are the seedings and ride values
+    // STEP TWO What are the ride values
     //
-    bool sbToday = appsettings->cvalue(context->athlete->cyclist, GC_SB_TODAY).toInt();
-    double lte = (double)exp(-1.0/ltsDays_);
-    double ste = (double)exp(-1.0/stsDays_);
 
     // clear what's there
     stress_.fill(0);
-    lts_.fill(0);
-    sts_.fill(0);
     sb_.fill(0);
     rr_.fill(0);
 
     planned_stress_.fill(0);
-    planned_lts_.fill(0);
-    planned_sts_.fill(0);
     planned_sb_.fill(0);
     planned_rr_.fill(0);
 
-    expected_lts_.fill(0);
-    expected_sts_.fill(0);
     expected_sb_.fill(0);
     expected_rr_.fill(0);
 
+    // add the stress scores
+    contributions_.clear();
+    foreach(RideItem *item, context->athlete->rideCache->rides()) {
+
+        Contribution c;
+        if (!contribution(item, c)) continue;
+
+        contributions_.insert(item, c);
+        if (c.planned)
+            planned_stress_[c.offset] += c.value;
+        else
+            stress_[c.offset] += c.value;
+        //qDebug()<<"stress_["<<c.offset<<"] :"<<stress_[c.offset];
+    }
+
+    // and lts/sts etc for every day
+    propagate(0);
+
+    //qDebug()<<"refresh PMC in="<<timer.elapsed()<<"ms";
+
+    pending_.clear();
+    dirty_.clear();
+    rescan_ = false;
+    isstale=false;
+}
+
+void
+PMCData::propagate(int from)
+{
+    if (from >= days_) return;
+
+    bool sbToday = sbToday_;
+    double lte = (double)exp(-1.0/ltsDays_);
+    double ste = (double)exp(-1.0/stsDays_);
+
+    // each day depends on the day before, so everything before
+    // from is still good and we carry on from there
+    for(int day=from; day < days_; day++) {
+        lts_[day] = sts_[day] = 0;
+        planned_lts_[day] = planned_sts_[day] = 0;
+        expected_lts_[day] = expected_sts_[day] = 0;
+    }
+
     // add the seeded values from seasons
     foreach(Season x, context->athlete->seasons->seasons) {
         if (x.getSeed()) {
             int offset = start_.daysTo(x.getStart());
+            if (offset < from) continue;
+
             lts_[offset] = x.getSeed() * -1;
             sts_[offset] = x.getSeed() * -1;
 
@@ -244,52 +429,29 @@ void PMCData::refresh()
         }
     }
 
-    // add the stress scores
-    foreach(RideItem *item, context->athlete->rideCache->rides()) {
-
-        if (!specification_.pass(item)) continue;
-
-        // seed with score for this one
-        int offset = start_.daysTo(item->dateTime.date());
-        if (offset > 0 && offset < stress_.count()) {
-
-            // although metrics are cleansed, we check here because development
-            // builds have a rideDB.json that has nan and inf values in it.
-            double value = 0;;
-            if (fromDataFilter) value = expr->eval(df, expr, 0, item).number;
-            else value = item->getForSymbol(metricName_);
-
-            if (!std::isinf(value) && !std::isnan(value)) {
-                if (item->planned)
-                    planned_stress_[offset] += value;
-                else
-                    stress_[offset] += value;
-                //qDebug()<<"stress_["<<offset<<"] :"<<stress_[offset];
-            }
-        }
-    }
-
     //
     // STEP THREE Calculate sts/lts, sb and rr
     //
     double lastLTS=0.0f;
     double lastSTS=0.0f;
 
-    double rollingStress=0;
+    double rollingStress= from ? rr_[from-1] : 0;
 
     double planned_lastLTS=0.0f;
     double planned_lastSTS=0.0f;
 
-    double planned_rollingStress=0;
+    double planned_rollingStress= from ? planned_rr_[from-1] : 0;
 
 #if notyet
     double expected_lastLTS=0.0f;
     double expected_lastSTS=0.0f;
 #endif
 
+    // only accumulated for days after today
     double expected_rollingStress=0;
+    if (from && start_.addDays(from-1).daysTo(today_)<0) expected_rollingStress = expected_rr_[from-1];
 
-    for(int day=0; day < days_; day++) {
+    for(int day=from; day < days_; day++) {
 
         // not seeded
         if (lts_[day] >=0 || sts_[day]>=0) {
@@ -365,14 +527,14 @@ void PMCData::refresh()
         // ****  EXPECTED  ****
         // ********************
 
-        if (start_.addDays(day).daysTo(QDate::currentDate())<0) {
+        if (start_.addDays(day).daysTo(today_)<0) {
             double lastLts = 0.0;
             double lastSts = 0.0;
             double ltsAtStsDays1 = 0.0;
             double ltsAtStsDays2 = 0.0;
 
             if (day) {
-                if (start_.addDays(day).daysTo(QDate::currentDate())<-1) {
+                if (start_.addDays(day).daysTo(today_)<-1) {
                     lastLts = expected_lts_[day-1];
                     lastSts = expected_sts_[day-1];
                 } else {
@@ -380,13 +542,13 @@ void PMCData::refresh()
                     lastSts = sts_[day-1];
                 }
                 if (day > stsDays_) {
-                    if (start_.addDays(day).daysTo(QDate::currentDate())<-1-stsDays_) {
+                    if (start_.addDays(day).daysTo(today_)<-1-stsDays_) {
                         ltsAtStsDays1 = expected_lts_[day-stsDays_-1];
                     } else {
                         ltsAtStsDays1 = lts_[day-stsDays_-1];
                     }
 
-                    if (start_.addDays(day).daysTo(QDate::currentDate())<-stsDays_) {
+                    if (start_.addDays(day).daysTo(today_)<-stsDays_) {
                         ltsAtStsDays2 = expected_lts_[day-stsDays_];
                     } else {
                         ltsAtStsDays2 = lts_[day-stsDays_];
@@ -431,10 +593,6 @@ void PMCData::refresh()
         }
 
     }
-
-    //qDebug()<<"refresh PMC in="<<timer.elapsed()<<"ms";
-
-    isstale=false;
 }
 
 int
@@ -109,6 +109,13 @@ class PMCData : public QObject {
         void invalidate();
         void refresh();
 
+        // when rides are added, changed or deleted we only
+        // need to update the stress on the days they touch and
+        // recalculate lts/sts etc from the earliest of them
+        void rideChanged(RideItem *);
+        void rideDeleted(RideItem *);
+        void rescan();
+
     private:
 
         // who we for ?
@@ -133,6 +140,28 @@ class PMCData : public QObject {
         QVector<double> expected_lts_, expected_sts_, expected_sb_, expected_rr_;
 
         bool isstale; // needs refreshing
+
+        // the stress each ride contributed and where, so we can
+        // work out which days change when the ride does
+        struct Contribution {
+            int offset;
+            double value;
+            bool planned;
+        };
+        bool contribution(RideItem *, Contribution &);
+        void sumStress(int offset);
+        void propagate(int from);
+
+        QHash<RideItem*, Contribution> contributions_;
+        QSet<RideItem*> pending_; // changed since last refresh
+        QSet<int> dirty_; // days that need their stress summing again
+        bool rescan_; // check every ride, e.g. metrics were refreshed
+
+        // what we last refreshed with, a full refresh is
+        // needed if any of these change
+        QDate today_;
+        bool sbToday_;
+        int lastStsDays_, lastLtsDays_;
 };
 
 #endif // _GC_StressCalculator_h
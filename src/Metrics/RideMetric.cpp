@@ -178,28 +178,87 @@ RideMetric::userMetricFingerprint(QList<UserMetricSettings> these)
     return qChecksum(fingers.constData(), fingers.size());
 }
 
+void
+RideMetricFactory::buildComputeOrder()
+{
+    // called with orderMutex held
+    int n = metricNames.count();
+
+    // resolve dependencies from symbols to indexes once
+    dependencyIndexes.fill(QVector<int>(), n);
+    for (int i=0; i<n; i++) {
+        foreach(const QString &dep, dependencies(metricNames[i])) {
+            RideMetric *m = metrics.value(dep, NULL);
+            if (m) dependencyIndexes[i] << m->index();
+        }
+    }
+
+    // depth first search to get a topological order, builtins
+    // first since user metrics don't declare their dependencies
+    // and may reference any of them
+    QVector<int> state(n, 0); // 0=unvisited, 1=visiting, 2=done
+    order.clear();
+    order.reserve(n);
+
+    for (int pass=0; pass<2; pass++) {
+        for (int i=0; i<n; i++) {
+
+            RideMetric *m = metrics.value(metricNames[i], NULL);
+            if (!m || state[i] || m->isUser() != (pass == 1)) continue;
+
+            QVector<int> stack;
+            stack << i;
+            while (!stack.isEmpty()) {
+                int current = stack.last();
+                if (state[current] == 0) {
+                    state[current] = 1;
+                    // a dependency already being visited is a cycle, it
+                    // is broken by leaving it where we first reached it
+                    foreach(int dep, dependencyIndexes[current])
+                        if (state[dep] == 0) stack << dep;
+                } else {
+                    stack.removeLast();
+                    if (state[current] == 1) {
+                        state[current] = 2;
+                        order << current;
+                    }
+                }
+            }
+        }
+    }
+    orderStale = false;
+}
+
 QHash<QString,RideMetricPtr>
 RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList &metrics)
 {
     const RideMetricFactory &factory = RideMetricFactory::instance();
 
-    // generate worklist from metrics we know
-    // bear in mind this can change as users add
-    // and remove user metrics
-    // builtin User metrics are computed after builtins
-    // since they don't have explicit dependencies set, yet.
-    QStringList builtin;
-    QStringList user;
-    foreach(QString metric, metrics)
-        if (factory.haveMetric(metric)) {
-            if (factory.rideMetric(metric)->isUser())
-                user << metric;
-            else
-                builtin << metric;
+    // the dependency graph is resolved to indexes once in the factory
+    // and it changes as users add and remove user metrics
+    QVector<int> order = factory.computeOrder();
+
+    // mark what we need; the metrics asked for and what they depend on
+    QVector<bool> wanted(factory.metricCount(), false);
+    QVector<int> todo;
+    bool user = false;
+    foreach(QString metric, metrics) {
+        const RideMetric *m = factory.rideMetric(metric);
+        if (m) {
+            if (m->isUser()) user = true;
+            todo << m->index();
         }
+    }
+    while (!todo.isEmpty()) {
+        int index = todo.takeLast();
+        if (index >= wanted.count() || wanted[index]) continue;
+        wanted[index] = true;
+        todo << factory.dependencies(index);
+    }
 
     // this is what we've completed as we go
     QHash<QString,RideMetric*> done;
+    done.reserve(factory.metricCount());
 
     // resize the metric array in the interval if needed
     if (spec.interval() && spec.interval()->metrics().size() < factory.metricCount()) 
@@ -209,63 +268,36 @@ RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList
     if (!spec.interval() && item->metrics().size() < factory.metricCount())
         item->metrics().resize(factory.metricCount());
 
-    // working through the todo list...
-    while (!builtin.isEmpty() || !user.isEmpty()) {
-
-        // next one to do, builtins first then user defined
-        QString symbol = builtin.isEmpty() ? user.takeFirst() :
-                                             builtin.takeFirst();
+    // work through in dependency order, so when we get
+    // to a metric everything it depends upon is done
+    foreach(int index, order) {
 
-        // doesn't exist !
-        if (!factory.haveMetric(symbol)) continue;
+        if (index >= wanted.count() || !wanted[index]) continue;
 
-        // does this one have any dependencies?
-        const QVector<QString> &deps = factory.dependencies(symbol);
+        const QString &symbol = factory.metricName(index);
 
-        bool ready = true;
+        // we clone so we can remain thread safe
+        // do not be tempted to change this (!)
+        RideMetric *m = factory.newMetric(symbol);
+        m->setValue(0.0);
+        m->setCount(0);
+        m->compute(item, spec, done);
 
-        // if the dependencies aren't done yet add to the end of the list
-        foreach (QString dep, deps) {
-            if (!done.contains(dep)) {
-                ready = false;
-                if (!builtin.contains(dep))
-                    builtin.append(dep);
-            }
-        }
-
-        // if all our depencies are computed we can do this one
-        if (ready) {
-
-            // we clone so we can remain thread safe
-            // do not be tempted to change this (!)
-            RideMetric *m = factory.newMetric(symbol);
-            m->setValue(0.0);
-            m->setCount(0);
-            m->compute(item, spec, done);
-
-            // override the computed value if set by user, but not for intervals
-            if (!spec.interval() && item->ride() && item->ride()->metricOverrides.contains(symbol))
-                m->override(item->ride()->metricOverrides.value(symbol));
-
-            // all computed add to the return list
-            done.insert(symbol, m);
-
-            // put into value array too. user metrics will interrogate
-            // this for symbol values, rather than the metric pointer
-            // this is crucial, even though RideItem and IntervalItem both
-            // update their values directly. But only need to bother if the
-            // user has defined any local metrics.
-            if (user.count()) {
-                if (spec.interval()) spec.interval()->metrics()[m->index()] = m->value();
-                else item->metrics()[m->index()] = m->value();
-            }
+        // override the computed value if set by user, but not for intervals
+        if (!spec.interval() && item->ride() && item->ride()->metricOverrides.contains(symbol))
+            m->override(item->ride()->metricOverrides.value(symbol));
 
-        } else {
+        // all computed add to the return list
+        done.insert(symbol, m);
 
-            // we need to wait for our dependencies so add
-            // to the back of the list 
-            if (!builtin.contains(symbol))
-                builtin.append(symbol);
+        // put into value array too. user metrics will interrogate
+        // this for symbol values, rather than the metric pointer
+        // this is crucial, even though RideItem and IntervalItem both
+        // update their values directly. But only need to bother if the
+        // user has defined any local metrics.
+        if (user) {
+            if (spec.interval()) spec.interval()->metrics()[m->index()] = m->value();
+            else item->metrics()[m->index()] = m->value();
         }
     }
 
@@ -273,7 +305,7 @@ RideMetric::computeMetrics(RideItem *item, Specification spec, const QStringList
     // which is deleted when reference count 0 and goes out of scope
     QHash<QString,RideMetricPtr> result;
     foreach (QString symbol, metrics) {
-        if (factory.haveMetric(symbol)) {
+        if (factory.haveMetric(symbol) && done.contains(symbol)) {
             result.insert(symbol, QSharedPointer<RideMetric>(done.value(symbol)));
             done.remove(symbol);
         }
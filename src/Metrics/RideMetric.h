@@ -40,6 +40,7 @@ class RideFile;
 class RideItem;
 class DataFilter;
 class DataFilterRuntime;
+class DataFilterProgram;
 class Leaf;
 
 // keep track of schema changes
@@ -338,6 +339,11 @@ public:
         // functions, to save lots of lookups
         Leaf *finit, *frelevant, *fsample, *fbefore, *fafter, *fvalue, *fcount;
 
+        // and compiled versions of those called for every sample
+        DataFilterProgram *psample, *pbefore, *pafter;
+        void iterate(RideItem *item, Specification spec, RideFileIterator::IterationSpec mode,
+                     Leaf *function, DataFilterProgram *compiled, const QHash<QString,RideMetric*> *c);
+
         // our runtime
         DataFilterRuntime *rt;
 
@@ -361,7 +367,16 @@ private:
     QHash<QString,QVector<QString>*> dependencyMap;
     bool dependenciesChecked;
 
-    RideMetricFactory() : dependenciesChecked(false) {}
+    // the dependency graph as metric indexes, along with the order
+    // metrics need to be computed in; builtins (dependencies first)
+    // and then user metrics. Rebuilt lazily when metrics change.
+    QVector<QVector<int> > dependencyIndexes;
+    QVector<int> order;
+    bool orderStale;
+    QMutex orderMutex;
+    void buildComputeOrder();
+
+    RideMetricFactory() : dependenciesChecked(false), orderStale(true) {}
     RideMetricFactory(const RideMetricFactory &other);
     RideMetricFactory &operator=(const RideMetricFactory &other);
 
@@ -398,6 +413,22 @@ private:
     const RideMetric::MetricType &metricType(int i) const { return metricTypes[i]; }
     const RideMetric *rideMetric(QString name) const { return metrics.value(name, NULL); }
 
+    // computation order and dependencies by index, see above
+    // returned by value since user metrics can be added and
+    // removed whilst rides are being refreshed
+    QVector<int> computeOrder() const {
+        RideMetricFactory *me = const_cast<RideMetricFactory*>(this);
+        QMutexLocker locker(&me->orderMutex);
+        if (orderStale) me->buildComputeOrder();
+        return order;
+    }
+    QVector<int> dependencies(int index) const {
+        RideMetricFactory *me = const_cast<RideMetricFactory*>(this);
+        QMutexLocker locker(&me->orderMutex);
+        if (orderStale) me->buildComputeOrder();
+        return index >= 0 && index < dependencyIndexes.count() ? dependencyIndexes[index] : QVector<int>();
+    }
+
     bool haveMetric(const QString &symbol) const {
         return metrics.contains(symbol);
     }
@@ -428,6 +459,9 @@ private:
                 metricNames.takeAt(firstUser);
                 metricTypes.remove(firstUser);
             }
+            orderMutex.lock();
+            orderStale = true;
+            orderMutex.unlock();
         }
     }
 
@@ -446,6 +480,9 @@ private:
             dependencyMap.insert(metric.symbol(), copy);
             dependenciesChecked = false;
         }
+        orderMutex.lock();
+        orderStale = true;
+        orderMutex.unlock();
         return true;
     }
 
@@ -38,6 +38,11 @@ UserMetric::UserMetric(Context *context, UserMetricSettings settings)
     fvalue = rt->functions.contains("value") ? rt->functions.value("value") : NULL;
     fcount = rt->functions.contains("count") ? rt->functions.value("count") : NULL;
 
+    // compile the functions called for every sample, if we can
+    psample = fsample ? DataFilterProgram::compile(rt, fsample) : NULL;
+    pbefore = fbefore ? DataFilterProgram::compile(rt, fbefore) : NULL;
+    pafter = fafter ? DataFilterProgram::compile(rt, fafter) : NULL;
+
     // we're not a clone, we're the original
     clone_ = false;
 }
@@ -57,6 +62,9 @@ UserMetric::UserMetric(const UserMetric *from) : RideMetric()
     this->fafter = from->fafter;
     this->fvalue = from->fvalue;
     this->fcount = from->fcount;
+    this->psample = from->psample;
+    this->pbefore = from->pbefore;
+    this->pafter = from->pafter;
 
     this->index_ = from->index_;
 
@@ -76,7 +84,12 @@ UserMetric::~UserMetric()
     RideMetricFactory::instance().mutex.lock();
     if (program) {
         program->refcount--;
-        if (!program->refcount) delete program;
+        if (!program->refcount) {
+            delete program;
+            delete psample;
+            delete pbefore;
+            delete pafter;
+        }
     }
     if (clone_) delete rt;
     RideMetricFactory::instance().mutex.unlock();
@@ -227,35 +240,17 @@ UserMetric::compute(RideItem *item, Specification spec, const QHash<QString,Ride
     }
 
     //qDebug()<<"BEFORE";
-    if (!spec.isEmpty(item->ride()) && fbefore) {
-        RideFileIterator it(item->ride(), spec, RideFileIterator::Before);
-
-        while(it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-            root->eval(rt, fbefore, 0, const_cast<RideItem*>(item), point, c, spec);
-        }
-    }
+    if (!spec.isEmpty(item->ride()) && fbefore)
+        iterate(item, spec, RideFileIterator::Before, fbefore, pbefore, c);
 
     //qDebug()<<"SAMPLE";
     // process samples, if there are any and a function exists
-    if (!spec.isEmpty(item->ride()) && fsample) {
-        RideFileIterator it(item->ride(), spec);
-
-        while(it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-            root->eval(rt, fsample, 0, const_cast<RideItem*>(item), point, c, spec);
-        }
-    }
+    if (!spec.isEmpty(item->ride()) && fsample)
+        iterate(item, spec, RideFileIterator::Sample, fsample, psample, c);
 
     //qDebug()<<"AFTER";
-    if (!spec.isEmpty(item->ride()) && fafter) {
-        RideFileIterator it(item->ride(), spec, RideFileIterator::After);
-
-        while(it.hasNext()) {
-            struct RideFilePoint *point = it.next();
-            root->eval(rt, fafter, 0, const_cast<RideItem*>(item), point, c, spec);
-        }
-    }
+    if (!spec.isEmpty(item->ride()) && fafter)
+        iterate(item, spec, RideFileIterator::After, fafter, pafter, c);
 
 
     //qDebug()<<"VALUE";
@@ -276,6 +271,39 @@ UserMetric::compute(RideItem *item, Specification spec, const QHash<QString,Ride
 }
 
 
+// call a function for each sample, compiled if possible
+void
+UserMetric::iterate(RideItem *item, Specification spec, RideFileIterator::IterationSpec mode,
+                    Leaf *function, DataFilterProgram *compiled, const QHash<QString,RideMetric*> *c)
+{
+    RideFileIterator it(item->ride(), spec, mode);
+
+    if (compiled && compiled->bind(rt, item, c, 0)) {
+
+        if (compiled->isBatch()) {
+
+            // a block of samples at a time
+            if (it.hasNext()) compiled->runBatch(rt, item, it.firstIndex(), it.lastIndex());
+
+        } else {
+
+            int index = it.firstIndex();
+            while(it.hasNext()) {
+                struct RideFilePoint *point = it.next();
+                compiled->run(rt, item, point, index++);
+            }
+        }
+        compiled->unbind(rt);
+
+    } else {
+
+        while(it.hasNext()) {
+            struct RideFilePoint *point = it.next();
+            root->eval(rt, function, 0, item, point, c, spec);
+        }
+    }
+}
+
 bool
 UserMetric::isTime() const
 {
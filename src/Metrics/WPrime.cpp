@@ -133,35 +133,43 @@ WPrime::setRide(RideFile *input)
     double offset = 0; // always start from zero seconds (e.g. intervals start at and offset in ride)
     bool first = true;
 
-    RideFilePoint *lp=NULL;
-    foreach(RideFilePoint *p, input->dataPoints()) {
+    // stream through the column store, km may not be present
+    const RideFileColumns *columns = input->columns();
+    const double *secs = columns->column(RideFile::secs);
+    const double *watts = columns->column(RideFile::watts);
+    const double *km = columns->column(RideFile::km);
+
+    int lp=-1;
+    for(int i=0; i<columns->count(); i++) {
 
         // yuck! nasty data
-        if (p->secs > (25*60*60)) return;
+        if (secs[i] > (25*60*60)) return;
 
         if (first) {
-            offset = p->secs;
+            offset = secs[i];
             first = false;
         }
 
+        double pkm = km ? km[i] : 0;
+
         // fill gaps in recording with zeroes
-        if (lp)
-            for(double t=lp->secs+input->recIntSecs();
-                (t + input->recIntSecs()) < p->secs;
+        if (lp >= 0)
+            for(double t=secs[lp]+input->recIntSecs();
+                (t + input->recIntSecs()) < secs[i];
                 t += input->recIntSecs()) {
                 points << QPointF(t-offset, 0);
-                pointsd << QPointF(t-offset, p->km * convert); // not zero !!!! this is a map from secs -> km not a series
+                pointsd << QPointF(t-offset, pkm * convert); // not zero !!!! this is a map from secs -> km not a series
             }
 
         // lets not go backwards -- or two samples at the same time
-        if ((lp && p->secs > lp->secs) || !lp) {
-            points << QPointF(p->secs - offset, p->watts);
-            pointsd << QPointF(p->secs - offset, p->km * convert);
+        if ((lp >= 0 && secs[i] > secs[lp]) || lp < 0) {
+            points << QPointF(secs[i] - offset, watts[i]);
+            pointsd << QPointF(secs[i] - offset, pkm * convert);
         }
 
         // update state
-        last = p->secs - offset;
-        lp = p;
+        last = secs[i] - offset;
+        lp = i;
     }
 
     // Create a spline
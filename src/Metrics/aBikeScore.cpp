@@ -81,7 +81,16 @@ class aXPower : public RideMetric {
         double total = 0.0;
         int count = 0;
 
-        while (it.hasNext()) {
+        // the whole ride, the weighted average is shared
+        bool whole = spec.interval() == NULL && secsDelta > 0;
+        if (whole) {
+
+            QVector<double> weights = item->ride()->transformed(RideFile::aPower, RideFile::EWMA, 25.0);
+            for (int i=0; i<weights.count(); i++) total += pow(weights[i], 4.0);
+            count = weights.count();
+        }
+
+        while (!whole && it.hasNext()) {
             struct RideFilePoint *point = it.next();
 
             while ((weighted > NEGLIGIBLE)
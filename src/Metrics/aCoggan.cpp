@@ -64,7 +64,14 @@ class aIsoPower : public RideMetric {
         // no point doing a rolling average if the
         // sample rate is greater than the rolling average
         // window!!
-        if (rollingwindowsize > 1) {
+        if (rollingwindowsize > 1 && spec.interval() == NULL) {
+
+            // the whole ride, the rolling average is shared
+            QVector<double> rolling = item->ride()->transformed(RideFile::aPower, RideFile::Rolling, 30);
+            for (int i=0; i<rolling.count(); i++) total += pow(rolling[i],4); // raise rolling average to 4th power
+            count = rolling.count();
+
+        } else if (rollingwindowsize > 1) {
 
             QVector<double> rolling(rollingwindowsize);
             int index = 0;
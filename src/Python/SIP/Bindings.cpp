@@ -536,9 +536,7 @@ Bindings::fromDateTime(PyObject* activity) const
                            QTime(PyDateTime_DATE_GET_HOUR(activity), PyDateTime_DATE_GET_MINUTE(activity), PyDateTime_DATE_GET_SECOND(activity), PyDateTime_DATE_GET_MICROSECOND(activity)/10));
 
         // search the RideCache
-        foreach(RideItem*item, context->athlete->rideCache->rides())
-            if (item->dateTime.toUTC() == dateTime.toUTC())
-                return const_cast<RideItem*>(item);
+        return context->athlete->rideCache->getRide(dateTime);
     }
 
     return NULL;
@@ -1801,17 +1799,19 @@ Bindings::seasonMeasures(bool all, QString group) const
         for (int i=0; i<fieldSymbols.count(); i++)
             fields[i] = PyList_New(size);
 
-        unsigned int index = 0;
+        QVector<QDate> dates;
         for(int k=0; k < size; k++) {
 
             // day today
-            if (start.addDays(k) >= range.from && start.addDays(k) <= range.to) {
-
-                for (int fieldIdx=0; fieldIdx<fields.count(); fieldIdx++)
-                    PyList_SET_ITEM(fields[fieldIdx], index, PyFloat_FromDouble(context->athlete->measures->getFieldValue(groupIdx, start.addDays(k), fieldIdx)));
+            if (start.addDays(k) >= range.from && start.addDays(k) <= range.to)
+                dates << start.addDays(k);
+        }
 
-                index++;
-            }
+        // each field for all the days in one go
+        for (int fieldIdx=0; fieldIdx<fields.count(); fieldIdx++) {
+            QVector<double> values = context->athlete->measures->getFieldValues(groupIdx, dates, fieldIdx);
+            for (int index=0; index<values.count(); index++)
+                PyList_SET_ITEM(fields[fieldIdx], index, PyFloat_FromDouble(values[index]));
         }
 
         // add to the dict
@@ -2003,32 +2003,24 @@ Bindings::seasonPeaks(bool all, DateRange range, QString filter, QList<RideFile:
     }
     specification.setFilterSet(fs);
 
-    // how many pass?
-    int size=0;
-    foreach(RideItem *item, context->athlete->rideCache->rides()) {
-
-        // apply filters
-        if (!specification.pass(item)) continue;
-
-        // do we want this one ?
-        if (all || range.pass(item->dateTime.date()))  size++;
-    }
+    // which pass? only look at rides in the date range
+    QList<RideItem*> rides;
+    RideCacheRange between = all ? context->athlete->rideCache->ridesBetween(QDate(), QDate())
+                                 : context->athlete->rideCache->ridesBetween(range.from, range.to);
+    for (RideCacheRange::const_iterator it = between.begin(); it != between.end(); ++it)
+        if (specification.pass(*it)) rides << *it;
+    int size = rides.count();
 
     // dates first
     PyObject* datetimelist = PyList_New(size);
 
     // fill with values for date
     int i=0;
-    foreach(RideItem *item, context->athlete->rideCache->rides()) {
-        // apply filters
-        if (!specification.pass(item)) continue;
-
-        if (all || range.pass(item->dateTime.date())) {
-            // add datetime to the list
-            QDate d = item->dateTime.date();
-            QTime t = item->dateTime.time();
-            PyList_SET_ITEM(datetimelist, i++, PyDateTime_FromDateAndTime(d.year(), d.month(), d.day(), t.hour(), t.minute(), t.second(), t.msec()*10));
-        }
+    foreach(RideItem *item, rides) {
+        // add datetime to the list
+        QDate d = item->dateTime.date();
+        QTime t = item->dateTime.time();
+        PyList_SET_ITEM(datetimelist, i++, PyDateTime_FromDateAndTime(d.year(), d.month(), d.day(), t.hour(), t.minute(), t.second(), t.msec()*10));
     }
 
     // add to the dict
@@ -2047,18 +2039,11 @@ Bindings::seasonPeaks(bool all, DateRange range, QString filter, QList<RideFile:
             // fill with values
             // get the value for the series and duration requested, although this is called
             int index=0;
-            foreach(RideItem *item, context->athlete->rideCache->rides()) {
-
-                // apply filters
-                if (!specification.pass(item)) continue;
-
-                // do we want this one ?
-                if (all || range.pass(item->dateTime.date())) {
+            foreach(RideItem *item, rides) {
 
-                    // for each series/duration independently its pretty quick since it lseeks to
-                    // the actual value, so /should't/ be too expensive.........
-                    PyList_SET_ITEM(list, index++, PyFloat_FromDouble(RideFileCache::best(item->context, item->fileName, pseries, pduration)));
-                }
+                // for each series/duration independently its pretty quick since it lseeks to
+                // the actual value, so /should't/ be too expensive.........
+                PyList_SET_ITEM(list, index++, PyFloat_FromDouble(RideFileCache::best(item->context, item->fileName, pseries, pduration)));
             }
 
             // add to the dict
@@ -3528,20 +3528,22 @@ RTool::measures(SEXP pAll, SEXP pGroup)
         for (int i=0; i<fieldSymbols.count(); i++)
             PROTECT(fields[i]=Rf_allocVector(REALSXP, size));
 
-        int index=0;
+        QVector<QDate> dates;
         int day = from;
         for(int k=0; k < size; k++) {
 
             // day today
-            if (day >= from && day <= to) {
-
-                for (int fieldIdx=0; fieldIdx<fields.count(); fieldIdx++)
-                    REAL(fields[fieldIdx])[index] = rtool->context->athlete->measures->getFieldValue(groupIdx, d1970.addDays(day), fieldIdx);
-                index++;
-            }
+            if (day >= from && day <= to) dates << d1970.addDays(day);
             day++;
         }
 
+        // each field for all the days in one go
+        for (int fieldIdx=0; fieldIdx<fields.count(); fieldIdx++) {
+            QVector<double> values = rtool->context->athlete->measures->getFieldValues(groupIdx, dates, fieldIdx);
+            for (int index=0; index<values.count(); index++)
+                REAL(fields[fieldIdx])[index] = values[index];
+        }
+
         // add to the list
         for (int fieldIdx=0; fieldIdx<fields.count(); fieldIdx++)
             SET_VECTOR_ELT(ans, fieldIdx+1, fields[fieldIdx]);